@@ -0,0 +1,277 @@
+#include "call_graph.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/memory.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace ehsim {
+
+namespace {
+
+constexpr uint32_t GPR_SP = 13;
+constexpr uint32_t GPR_LR = 14;
+
+bool is_call(uint16_t instruction)
+{
+  // bl (first halfword), or blx Rm
+  return (instruction & 0xF800) == 0xF000 || (instruction & 0xFF87) == 0x4780;
+}
+
+bool is_return(uint16_t instruction)
+{
+  // bx lr, pop with pc in the register list, or udf that returns from a native runtime helper
+  return instruction == 0x4770 || (instruction & 0xFF00) == 0xBD00
+         || (instruction & 0xFF00) == 0xDE00;
+}
+
+uint64_t to_picojoules(double energy)
+{
+  return static_cast<uint64_t>(std::llround(energy * 1e3));
+}
+}
+
+call_graph_weight parse_call_graph_weight(std::string const &name)
+{
+  if(name == "cycles") {
+    return call_graph_weight::cycles;
+  } else if(name == "energy") {
+    return call_graph_weight::energy;
+  } else if(name == "backup_energy") {
+    return call_graph_weight::backup_energy;
+  } else if(name == "wasted_cycles") {
+    return call_graph_weight::wasted_cycles;
+  } else if(name == "wasted_energy") {
+    return call_graph_weight::wasted_energy;
+  }
+
+  throw std::runtime_error("Unknown call graph weight: " + name);
+}
+
+void call_graph_profile::start(uint32_t pc, uint32_t sp)
+{
+  nodes.clear();
+  children.clear();
+  dirty.clear();
+
+  nodes.push_back(node{pc & ~0x1u, 0, 1, 0, 0.0, 0.0, 0, 0.0, 0, 0, 0, 0.0, false});
+  base_sp = sp;
+
+  frames.assign(1, frame{0, 0, sp});
+  backed_up_frames = frames;
+  frames_changed = false;
+}
+
+void call_graph_profile::record(uint32_t pc, uint32_t cycles, double energy)
+{
+  auto &top = frames.back();
+  auto &current = nodes[top.node];
+
+  current.cycles += cycles;
+  current.energy += energy;
+  if(!current.dirty) {
+    current.dirty = true;
+    dirty.push_back(top.node);
+  }
+
+  auto const sp = thumbulator::cpu_get_gpr(GPR_SP);
+  if(sp <= top.entry_sp) {
+    current.max_frame = std::max(current.max_frame, top.entry_sp - sp);
+  }
+  if(sp <= base_sp) {
+    current.max_depth = std::max(current.max_depth, base_sp - sp);
+  }
+
+  if(!thumbulator::BRANCH_WAS_TAKEN) {
+    return;
+  }
+
+  uint16_t instruction;
+  thumbulator::fetch_instruction(pc, &instruction);
+
+  // PC seen is PC + 4, and the lowest bit marks thumb mode
+  auto const target = (thumbulator::cpu_get_pc() - 0x4) & ~0x1u;
+  if(is_call(instruction)) {
+    call(target, thumbulator::cpu_get_gpr(GPR_LR) & ~0x1u, sp);
+  } else if(is_return(instruction)) {
+    return_to(target);
+  }
+}
+
+void call_graph_profile::backup(double energy)
+{
+  nodes[frames.back().node].backup_energy += energy;
+
+  for(auto const index : dirty) {
+    auto &executed = nodes[index];
+    executed.cycles_at_backup = executed.cycles;
+    executed.energy_at_backup = executed.energy;
+    executed.dirty = false;
+  }
+  dirty.clear();
+
+  if(frames_changed) {
+    backed_up_frames = frames;
+    frames_changed = false;
+  }
+}
+
+void call_graph_profile::power_off()
+{
+  for(auto const index : dirty) {
+    auto &lost = nodes[index];
+    lost.wasted_cycles += lost.cycles - lost.cycles_at_backup;
+    lost.wasted_energy += lost.energy - lost.energy_at_backup;
+    lost.cycles_at_backup = lost.cycles;
+    lost.energy_at_backup = lost.energy;
+    lost.dirty = false;
+  }
+  dirty.clear();
+
+  // execution resumes with the stack of the last backup
+  frames = backed_up_frames;
+  frames_changed = false;
+}
+
+uint32_t call_graph_profile::child(uint32_t parent, uint32_t function)
+{
+  auto const key = (static_cast<uint64_t>(parent) << 32) | function;
+
+  auto const found = children.find(key);
+  if(found != children.end()) {
+    return found->second;
+  }
+
+  auto const index = static_cast<uint32_t>(nodes.size());
+  nodes.push_back(node{function, parent, 0, 0, 0.0, 0.0, 0, 0.0, 0, 0, 0, 0.0, false});
+  children.emplace(key, index);
+
+  return index;
+}
+
+void call_graph_profile::call(uint32_t function, uint32_t return_address, uint32_t sp)
+{
+  auto const callee = child(frames.back().node, function);
+  nodes[callee].calls++;
+
+  frames.push_back(frame{callee, return_address, sp});
+  frames_changed = true;
+}
+
+void call_graph_profile::return_to(uint32_t address)
+{
+  // pop every frame up to the one returned from, and ignore jumps that are not returns
+  for(auto i = frames.size() - 1; i > 0; --i) {
+    if(frames[i].return_address == address) {
+      frames.resize(i);
+      frames_changed = true;
+      return;
+    }
+  }
+}
+
+std::string call_graph_profile::name_of(thumbulator::symbol_table const &symbols,
+    uint32_t function) const
+{
+  auto const found = symbols.function_at(function);
+  if(found != nullptr) {
+    return found->name;
+  }
+
+  std::ostringstream name;
+  name << "0x" << std::hex << std::setw(8) << std::setfill('0') << function;
+
+  return name.str();
+}
+
+void call_graph_profile::write_folded(std::string const &path_to_report,
+    thumbulator::symbol_table const &symbols,
+    call_graph_weight weight) const
+{
+  std::ofstream out(path_to_report);
+  if(!out.good()) {
+    throw std::runtime_error("Could not open call graph report: " + path_to_report);
+  }
+
+  // nodes are created after their parents, so every parent's stack is named first
+  std::vector<std::string> stacks(nodes.size());
+  std::map<std::string, uint64_t> folded;
+  for(uint32_t i = 0; i < nodes.size(); ++i) {
+    auto const &current = nodes[i];
+
+    stacks[i] = name_of(symbols, current.function);
+    if(i != 0) {
+      stacks[i] = stacks[current.parent] + ";" + stacks[i];
+    }
+
+    uint64_t value = 0;
+    switch(weight) {
+    case call_graph_weight::cycles:
+      value = current.cycles;
+      break;
+    case call_graph_weight::energy:
+      value = to_picojoules(current.energy);
+      break;
+    case call_graph_weight::backup_energy:
+      value = to_picojoules(current.backup_energy);
+      break;
+    case call_graph_weight::wasted_cycles:
+      value = current.wasted_cycles;
+      break;
+    case call_graph_weight::wasted_energy:
+      value = to_picojoules(current.wasted_energy);
+      break;
+    }
+
+    // different call sites of a function at the same depth fold into one stack
+    if(value != 0) {
+      folded[stacks[i]] += value;
+    }
+  }
+
+  for(auto const &stack : folded) {
+    out << stack.first << " " << stack.second << "\n";
+  }
+}
+
+void call_graph_profile::write_stack_usage(std::string const &path_to_report,
+    thumbulator::symbol_table const &symbols) const
+{
+  std::ofstream out(path_to_report);
+  if(!out.good()) {
+    throw std::runtime_error("Could not open stack usage report: " + path_to_report);
+  }
+
+  struct usage {
+    uint64_t calls;
+    uint32_t max_frame;
+    uint32_t max_depth;
+  };
+
+  std::map<std::string, usage> functions;
+  for(auto const &current : nodes) {
+    auto &function = functions[name_of(symbols, current.function)];
+    function.calls += current.calls;
+    function.max_frame = std::max(function.max_frame, current.max_frame);
+    function.max_depth = std::max(function.max_depth, current.max_depth);
+  }
+
+  std::vector<std::pair<std::string, usage>> sorted(functions.begin(), functions.end());
+  std::stable_sort(sorted.begin(), sorted.end(),
+      [](std::pair<std::string, usage> const &a, std::pair<std::string, usage> const &b) {
+        return a.second.max_depth > b.second.max_depth;
+      });
+
+  out << "function, calls, frame_bytes, stack_bytes\n";
+  for(auto const &function : sorted) {
+    out << function.first << ", " << function.second.calls << ", " << function.second.max_frame
+        << ", " << function.second.max_depth << "\n";
+  }
+}
+}
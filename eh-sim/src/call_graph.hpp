@@ -0,0 +1,141 @@
+#ifndef EH_SIM_CALL_GRAPH_HPP
+#define EH_SIM_CALL_GRAPH_HPP
+
+#include <thumbulator/program.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * What the folded stacks of a call graph profile are weighted by.
+ */
+enum class call_graph_weight { cycles, energy, backup_energy, wasted_cycles, wasted_energy };
+
+/**
+ * Parse the name of a call graph weight.
+ */
+call_graph_weight parse_call_graph_weight(std::string const &name);
+
+/**
+ * Attributes execution, energy, and wasted work to the call stacks of the application.
+ *
+ * The guest call stack is shadowed from the instructions that call and return: bl and blx push a
+ * frame, while bx lr and pop {..., pc} pop the frames up to the one they return to. Functions that
+ * push lr are returned from with pop {pc}, so both pairs are matched by their return address.
+ * The shadow stack is saved on every backup and rolled back when the device powers off.
+ */
+class call_graph_profile {
+public:
+  /**
+   * Start the profile at the first instruction to execute.
+   *
+   * @param pc The address of the first instruction.
+   * @param sp The stack pointer before the first instruction.
+   */
+  void start(uint32_t pc, uint32_t sp);
+
+  /**
+   * Count an executed instruction and follow the calls and returns it made.
+   *
+   * Called after the instruction executed, with the CPU in its new state.
+   *
+   * @param pc The address of the instruction.
+   * @param cycles The number of cycles the instruction took.
+   * @param energy The energy the instruction consumed (nJ).
+   */
+  void record(uint32_t pc, uint32_t cycles, double energy);
+
+  /**
+   * The work executed so far is safe.
+   *
+   * @param energy The energy of the backup (nJ).
+   */
+  void backup(double energy);
+
+  /**
+   * The work executed since the last backup is lost, and so is the call stack.
+   */
+  void power_off();
+
+  /**
+   * Write the folded stacks of the profile, one line per stack, for flame graph tools.
+   *
+   * Energy weights are written in picojoules, so every weight is an integer.
+   *
+   * @param path_to_report The file to write.
+   * @param symbols The symbols of the application, to name the functions.
+   * @param weight What to weigh every stack by.
+   */
+  void write_folded(std::string const &path_to_report,
+      thumbulator::symbol_table const &symbols,
+      call_graph_weight weight) const;
+
+  /**
+   * Write the stack high-water mark of every function.
+   *
+   * The frame is the deepest the function's own stack went below its caller's stack pointer. The
+   * depth is the deepest the whole stack went while the function was executing, which bounds the
+   * stack a checkpoint taken in the function has to save.
+   *
+   * @param path_to_report The file to write.
+   * @param symbols The symbols of the application, to name the functions.
+   */
+  void write_stack_usage(std::string const &path_to_report,
+      thumbulator::symbol_table const &symbols) const;
+
+private:
+  struct node {
+    uint32_t function;
+    uint32_t parent;
+
+    uint64_t calls;
+    uint64_t cycles;
+    double energy;
+    double backup_energy;
+    uint64_t wasted_cycles;
+    double wasted_energy;
+
+    uint32_t max_frame;
+    uint32_t max_depth;
+
+    // the cycles and energy at the last backup, and whether it executed since
+    uint64_t cycles_at_backup;
+    double energy_at_backup;
+    bool dirty;
+  };
+
+  struct frame {
+    uint32_t node;
+    uint32_t return_address;
+    uint32_t entry_sp;
+  };
+
+  // the root of every stack is node 0
+  std::vector<node> nodes;
+  std::unordered_map<uint64_t, uint32_t> children;
+
+  std::vector<frame> frames;
+  std::vector<frame> backed_up_frames;
+  bool frames_changed = false;
+
+  uint32_t base_sp = 0;
+
+  // the nodes executed since the last backup
+  std::vector<uint32_t> dirty;
+
+  uint32_t child(uint32_t parent, uint32_t function);
+
+  void call(uint32_t function, uint32_t return_address, uint32_t sp);
+
+  void return_to(uint32_t address);
+
+  std::string name_of(thumbulator::symbol_table const &symbols, uint32_t function) const;
+};
+}
+
+#endif //EH_SIM_CALL_GRAPH_HPP
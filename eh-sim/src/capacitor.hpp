@@ -20,6 +20,19 @@ inline double calculate_energy(double const voltage, double const capacitance)
   return 0.5 * capacitance * voltage * voltage * 1e9;
 }
 
+/**
+ * Calculate the voltage across a capacitor.
+ *
+ * @param energy The energy stored in nJ.
+ * @param capacitance The capacitance in farads (F).
+ *
+ * @return The voltage in volts (V).
+ */
+inline double calculate_voltage(double const energy, double const capacitance)
+{
+  return sqrt(2 * energy * 1e-9 / capacitance);
+}
+
 class capacitor {
 public:
   /**
@@ -76,7 +89,7 @@ public:
    */
   void update_voltage()
   {
-    V = sqrt(2 * energy * 1e-9 / C);
+    V = calculate_voltage(energy, C);
   }
 
   /**
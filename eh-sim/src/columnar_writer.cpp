@@ -0,0 +1,206 @@
+#include "columnar_writer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace ehsim {
+
+namespace {
+
+constexpr char COLUMNAR_MAGIC[8] = {'E', 'H', 'C', 'O', 'L', 'S', '\0', '\0'};
+constexpr char COLUMNAR_END_MAGIC[8] = {'E', 'H', 'C', 'O', 'L', 'E', 'N', 'D'};
+constexpr uint32_t COLUMNAR_VERSION = 1;
+
+bool host_is_little_endian()
+{
+  uint16_t const probe = 1;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &probe, 1);
+
+  return first_byte == 1;
+}
+
+uint64_t to_little_endian(uint64_t value)
+{
+  if(host_is_little_endian()) {
+    return value;
+  }
+
+  uint64_t swapped = 0;
+  for(int i = 0; i < 8; ++i) {
+    swapped = (swapped << 8) | ((value >> (8 * i)) & 0xFF);
+  }
+
+  return swapped;
+}
+}
+
+columnar_writer::columnar_writer(std::string const &path_to_file,
+    std::vector<column> const &columns,
+    size_t rows_per_chunk)
+    : fd(std::fopen(path_to_file.c_str(), "wb"))
+    , columns(columns)
+    , rows_per_chunk(rows_per_chunk)
+    , current(columns.size())
+{
+  if(fd == nullptr) {
+    throw std::runtime_error("Could not open output file: " + path_to_file);
+  }
+
+  try {
+    write_header();
+  } catch(...) {
+    std::fclose(fd);
+    throw;
+  }
+
+  for(auto &values : current) {
+    values.reserve(rows_per_chunk);
+  }
+}
+
+void columnar_writer::write_header()
+{
+  // write the chunks with few, large system calls
+  std::setvbuf(fd, nullptr, _IOFBF, 1 << 20);
+
+  write(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+
+  uint8_t header[8];
+  uint32_t const fields[2] = {COLUMNAR_VERSION, static_cast<uint32_t>(columns.size())};
+  for(int i = 0; i < 8; ++i) {
+    header[i] = static_cast<uint8_t>(fields[i / 4] >> (8 * (i % 4)));
+  }
+  write(header, sizeof(header));
+
+  for(auto const &col : columns) {
+    if(col.name.size() > 255) {
+      throw std::runtime_error("Column name is too long: " + col.name);
+    }
+
+    uint8_t const description[2] = {
+        static_cast<uint8_t>(col.type), static_cast<uint8_t>(col.name.size())};
+    write(description, sizeof(description));
+    write(col.name.data(), col.name.size());
+  }
+
+  offset = static_cast<uint64_t>(std::ftell(fd));
+}
+
+columnar_writer::~columnar_writer()
+{
+  try {
+    close();
+  } catch(...) {
+    // destructors must not throw, call close to see errors
+  }
+}
+
+void columnar_writer::put(int64_t value)
+{
+  put_raw(static_cast<uint64_t>(value), column_type::integer);
+}
+
+void columnar_writer::put(double value)
+{
+  uint64_t raw;
+  std::memcpy(&raw, &value, sizeof(raw));
+
+  put_raw(raw, column_type::real);
+}
+
+void columnar_writer::put_raw(uint64_t raw, column_type type)
+{
+  if(columns[next_column].type != type) {
+    throw std::logic_error("Wrong value type for column " + columns[next_column].name);
+  }
+
+  current[next_column].push_back(raw);
+
+  if(++next_column == columns.size()) {
+    next_column = 0;
+
+    if(++rows_in_chunk == rows_per_chunk) {
+      flush_chunk();
+    }
+  }
+}
+
+void columnar_writer::flush_chunk()
+{
+  if(rows_in_chunk == 0) {
+    return;
+  }
+
+  index.emplace_back(offset, rows_in_chunk);
+  offset += rows_in_chunk * columns.size() * sizeof(uint64_t);
+
+  // the buffers keep their capacity for the next chunk
+  for(auto &values : current) {
+    if(!host_is_little_endian()) {
+      for(auto &value : values) {
+        value = to_little_endian(value);
+      }
+    }
+
+    write(values.data(), values.size() * sizeof(uint64_t));
+    values.clear();
+  }
+  rows_in_chunk = 0;
+}
+
+void columnar_writer::close()
+{
+  if(fd == nullptr) {
+    return;
+  }
+
+  // drop an incomplete row, but still finish the file
+  auto const incomplete_row = next_column != 0;
+  for(; next_column > 0; --next_column) {
+    current[next_column - 1].pop_back();
+  }
+
+  flush_chunk();
+
+  // footer: the chunk index followed by the total number of rows
+  auto const footer_offset = offset;
+  uint64_t total_rows = 0;
+
+  write_u64(index.size());
+  for(auto const &entry : index) {
+    write_u64(entry.first);
+    write_u64(entry.second);
+    total_rows += entry.second;
+  }
+  write_u64(total_rows);
+
+  // trailer: where to find the footer
+  write_u64(footer_offset);
+  write(COLUMNAR_END_MAGIC, sizeof(COLUMNAR_END_MAGIC));
+
+  auto const close_failed = std::fclose(fd) != 0;
+  fd = nullptr;
+
+  if(close_failed) {
+    throw std::runtime_error("Could not write columnar output file.");
+  }
+
+  if(incomplete_row) {
+    throw std::logic_error("Columnar file was closed in the middle of a row.");
+  }
+}
+
+void columnar_writer::write(void const *data, size_t size)
+{
+  if(std::fwrite(data, 1, size, fd) != size) {
+    throw std::runtime_error("Could not write columnar output file.");
+  }
+}
+
+void columnar_writer::write_u64(uint64_t value)
+{
+  auto const raw = to_little_endian(value);
+  write(&raw, sizeof(raw));
+}
+}
@@ -0,0 +1,94 @@
+#ifndef EH_SIM_COLUMNAR_WRITER_HPP
+#define EH_SIM_COLUMNAR_WRITER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * The type of the values stored in a column.
+ *
+ * Every type is stored as 8 little-endian bytes.
+ */
+enum class column_type : uint8_t { integer = 0, real = 1 };
+
+struct column {
+  std::string name;
+  column_type type;
+};
+
+/**
+ * Writes a table in a binary, columnar format.
+ *
+ * The file starts with a header that names the columns and their types. Rows are grouped into
+ * chunks, and each chunk stores the values of one column after the other. A footer at the end of
+ * the file indexes the chunks.
+ */
+class columnar_writer {
+public:
+  /**
+   * Constructor.
+   *
+   * @param path_to_file The file to write.
+   * @param columns The columns of the table, in the order their values are put.
+   * @param rows_per_chunk The number of rows to buffer before writing them to disk.
+   */
+  columnar_writer(std::string const &path_to_file,
+      std::vector<column> const &columns,
+      size_t rows_per_chunk = 1 << 16);
+
+  /**
+   * Destructor, finishes the file if close was not called.
+   */
+  ~columnar_writer();
+
+  columnar_writer(columnar_writer const &) = delete;
+  columnar_writer &operator=(columnar_writer const &) = delete;
+
+  /**
+   * Put the value of the next integer column in the current row.
+   */
+  void put(int64_t value);
+
+  /**
+   * Put the value of the next real column in the current row.
+   */
+  void put(double value);
+
+  /**
+   * Write any buffered rows and the footer, then close the file.
+   */
+  void close();
+
+private:
+  // one buffer per column, holding the raw 8-byte values of the chunk's rows
+  using chunk = std::vector<std::vector<uint64_t>>;
+
+  std::FILE *fd;
+  std::vector<column> const columns;
+  size_t const rows_per_chunk;
+
+  chunk current;
+  size_t next_column = 0;
+  size_t rows_in_chunk = 0;
+
+  // the offset and row count of every chunk written so far
+  std::vector<std::pair<uint64_t, uint64_t>> index;
+  uint64_t offset = 0;
+
+  void write_header();
+
+  void put_raw(uint64_t raw, column_type type);
+
+  void flush_chunk();
+
+  void write(void const *data, size_t size);
+
+  void write_u64(uint64_t value);
+};
+}
+
+#endif //EH_SIM_COLUMNAR_WRITER_HPP
@@ -0,0 +1,65 @@
+#include <argagg/argagg.hpp>
+
+#include <iostream>
+
+#include "trace_format.hpp"
+
+void print_usage(std::ostream &stream, argagg::parser const &arguments)
+{
+  argagg::fmt_ostream help(stream);
+
+  help << "Convert a text voltage trace into the binary format.\n\n";
+  help << "eh-trace-convert [options] ARG [ARG...]\n\n";
+  help << arguments;
+}
+
+int main(int argc, char *argv[])
+{
+  argagg::parser arguments{{{"help", {"-h", "--help"}, "display help information", 0},
+      {"input", {"-i", "--input"}, "path to the text voltage trace", 1},
+      {"output", {"-o", "--output"}, "path to the binary voltage trace", 1},
+      {"period", {"--sample-period"}, "time between samples (nanoseconds)", 1},
+      {"format", {"--format"}, "sample encoding: float32 (default), fixed16, or compressed16", 1},
+      {"block", {"--block-size"}, "samples per compressed block (default 4096)", 1},
+      {"cumulative", {"--cumulative-energy"}, "add the cumulative energy column", 0}}};
+
+  try {
+    auto const options = arguments.parse(argc, argv);
+
+    if(options["help"]) {
+      print_usage(std::cout, arguments);
+
+      return EXIT_SUCCESS;
+    }
+
+    if(options["input"].count() == 0 || options["output"].count() == 0) {
+      throw std::runtime_error("Missing path to input or output voltage trace.");
+    }
+
+    if(options["period"].count() == 0) {
+      throw std::runtime_error("No sample period provided for the voltage trace.");
+    }
+
+    auto const format_select = options["format"].as<std::string>("float32");
+    auto format = ehsim::trace_sample_format::float32;
+    if(format_select == "fixed16") {
+      format = ehsim::trace_sample_format::fixed16;
+    } else if(format_select == "compressed16") {
+      format = ehsim::trace_sample_format::compressed16;
+    } else if(format_select != "float32") {
+      throw std::runtime_error("Unknown sample format: " + format_select);
+    }
+
+    auto const voltages = ehsim::read_text_trace(options["input"].as<std::string>());
+    ehsim::write_binary_trace(options["output"].as<std::string>(), voltages,
+        options["period"].as<uint64_t>(), format, options["cumulative"].count() > 0,
+        options["block"].as<uint32_t>(4096));
+
+    std::cout << "Converted " << voltages.size() << " samples.\n";
+  } catch(std::exception const &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,4 +1,9 @@
 #include <argagg/argagg.hpp>
+#include <thumbulator/console.hpp>
+#include <thumbulator/hle.hpp>
+#include <thumbulator/loop.hpp>
+#include <thumbulator/memory.hpp>
+#include <thumbulator/program.hpp>
 
 #include <fstream>
 #include <iomanip>
@@ -7,9 +12,19 @@
 
 #include "scheme/backup_every_cycle.hpp"
 #include "scheme/clank.hpp"
+#include "scheme/hibernus.hpp"
+#include "scheme/mementos.hpp"
+#include "scheme/oracle.hpp"
 #include "scheme/parametric.hpp"
+#include "scheme/undo_log.hpp"
 
+#include "call_graph.hpp"
+#include "columnar_writer.hpp"
+#include "profile.hpp"
 #include "simulate.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "synthetic_source.hpp"
 #include "voltage_trace.hpp"
 
 void print_usage(std::ostream &stream, argagg::parser const &arguments)
@@ -31,35 +46,240 @@ void ensure_file_exists(std::string const &path_to_file)
 
 void validate(argagg::parser_results const &options)
 {
-  if(options["binary"].count() == 0) {
-    throw std::runtime_error("Missing path to application binary.");
+  if(options["resume"].count() > 0) {
+    if(options["snapshot_at"].count() > 0) {
+      throw std::runtime_error("Cannot both resume from and create a snapshot.");
+    }
+
+    auto const path_to_snapshot = options["resume"].as<std::string>();
+    ensure_file_exists(path_to_snapshot);
+  } else {
+    if(options["binary"].count() == 0) {
+      throw std::runtime_error("Missing path to application binary.");
+    }
+
+    auto const path_to_binary = options["binary"].as<std::string>();
+    ensure_file_exists(path_to_binary);
+  }
+
+  if(options["snapshot_at"].count() > 0) {
+    // the warm-up does not use the energy model
+    return;
   }
 
-  auto const path_to_binary = options["binary"].as<std::string>();
-  ensure_file_exists(path_to_binary);
+  if(options["source"].count() > 0) {
+    if(options["voltages"].count() > 0) {
+      throw std::runtime_error("Cannot use both a voltage trace and a synthetic source.");
+    }
+
+    return;
+  }
 
   if(options["voltages"].count() == 0) {
     throw std::runtime_error("Missing path to voltage trace.");
   }
 
   auto const path_to_voltage_trace = options["voltages"].as<std::string>();
-  ensure_file_exists(path_to_voltage_trace);
+  if(path_to_voltage_trace != "-") {
+    ensure_file_exists(path_to_voltage_trace);
+  }
+}
+
+std::chrono::nanoseconds parse_sample_period(std::string const &period)
+{
+  size_t unit_start = 0;
+  uint64_t value = 0;
+  try {
+    value = std::stoull(period, &unit_start);
+  } catch(std::logic_error const &) {
+    throw std::runtime_error("Invalid voltage trace sampling rate: " + period);
+  }
+
+  // a plain number is in milliseconds, as it always has been
+  auto const unit = period.substr(unit_start);
+  if(unit.empty() || unit == "ms") {
+    return std::chrono::milliseconds(value);
+  } else if(unit == "us") {
+    return std::chrono::microseconds(value);
+  } else if(unit == "ns") {
+    return std::chrono::nanoseconds(value);
+  } else if(unit == "s") {
+    return std::chrono::seconds(value);
+  }
+
+  throw std::runtime_error("Invalid voltage trace sampling rate: " + period);
+}
+
+thumbulator::memory_region parse_memory_region(std::string const &spec)
+{
+  auto const first = spec.find(':');
+  auto const second = first == std::string::npos ? first : spec.find(':', first + 1);
+  if(second == std::string::npos) {
+    throw std::runtime_error("Invalid memory region: " + spec);
+  }
+
+  ehsim::memory_technology technology{};
+  auto const name = spec.substr(0, first);
+  if(name == "sram") {
+    technology = ehsim::SRAM_TECHNOLOGY;
+  } else if(name == "fram") {
+    technology = ehsim::FRAM_TECHNOLOGY;
+  } else if(name == "mram") {
+    technology = ehsim::MRAM_TECHNOLOGY;
+  } else if(name == "flash") {
+    technology = ehsim::FLASH_TECHNOLOGY;
+  } else {
+    throw std::runtime_error("Unknown memory technology: " + name);
+  }
+
+  uint32_t start = 0;
+  uint32_t size_bytes = 0;
+  try {
+    size_t end = 0;
+    auto const start_text = spec.substr(first + 1, second - first - 1);
+    start = static_cast<uint32_t>(std::stoul(start_text, &end, 0));
+    if(end != start_text.size()) {
+      throw std::invalid_argument(start_text);
+    }
+
+    auto const size_text = spec.substr(second + 1);
+    size_bytes = static_cast<uint32_t>(std::stoul(size_text, &end, 0));
+    if(end != size_text.size()) {
+      throw std::invalid_argument(size_text);
+    }
+  } catch(std::logic_error const &) {
+    throw std::runtime_error("Invalid memory region: " + spec);
+  }
+
+  return {start, size_bytes, technology.read_latency, technology.write_latency,
+      technology.read_energy, technology.write_energy, technology.is_volatile};
+}
+
+void write_csv(ehsim::stats_bundle const &stats, std::string const &output_file_name)
+{
+  std::ofstream out(output_file_name);
+  out.setf(std::ios::fixed);
+  out << "id, E, epsilon, epsilon_C, tau_B, alpha_B, energy_consumed, n_B, tau_P, tau_D, e_P, e_B, "
+         "e_R, sim_p, eh_p\n";
+
+  int id = 0;
+  for(auto const &model : stats.models) {
+    out << id++ << ", ";
+
+    auto const eh_parameters = ehsim::eh_model_parameters(model);
+    out << std::setprecision(3) << eh_parameters.E << ", ";
+    out << std::setprecision(3) << eh_parameters.epsilon << ", ";
+    out << std::setprecision(3) << eh_parameters.epsilon_C << ", ";
+    out << std::setprecision(2) << eh_parameters.tau_B << ", ";
+    out << std::setprecision(4) << eh_parameters.alpha_B << ", ";
+
+    auto const tau_D = model.time_for_instructions - model.time_forward_progress;
+    out << std::setprecision(3) << model.energy_consumed << ", ";
+    out << std::setprecision(0) << model.num_backups << ", ";
+    out << std::setprecision(0) << model.time_forward_progress << ", ";
+    out << std::setprecision(0) << tau_D << ", ";
+    out << std::setprecision(3) << model.energy_forward_progress << ", ";
+    out << std::setprecision(3) << model.energy_for_backups << ", ";
+    out << std::setprecision(3) << model.energy_for_restore << ", ";
+
+    out << std::setprecision(3) << model.progress << ", ";
+    out << std::setprecision(3) << model.eh_progress << "\n";
+  }
+}
+
+void write_columnar(ehsim::stats_bundle const &stats, std::string const &output_file_name)
+{
+  using ehsim::column_type;
+
+  ehsim::columnar_writer out(output_file_name,
+      {{"id", column_type::integer}, {"E", column_type::real}, {"epsilon", column_type::real},
+          {"epsilon_C", column_type::real}, {"tau_B", column_type::real},
+          {"alpha_B", column_type::real}, {"energy_consumed", column_type::real},
+          {"n_B", column_type::integer}, {"tau_P", column_type::integer},
+          {"tau_D", column_type::integer}, {"e_P", column_type::real}, {"e_B", column_type::real},
+          {"e_R", column_type::real}, {"sim_p", column_type::real}, {"eh_p", column_type::real}});
+
+  int64_t id = 0;
+  for(auto const &model : stats.models) {
+    out.put(id++);
+
+    auto const eh_parameters = ehsim::eh_model_parameters(model);
+    out.put(eh_parameters.E);
+    out.put(eh_parameters.epsilon);
+    out.put(eh_parameters.epsilon_C);
+    out.put(eh_parameters.tau_B);
+    out.put(eh_parameters.alpha_B);
 
-  if(options["rate"].count() == 0) {
-    throw std::runtime_error("No sampling rate provided for the voltage trace.");
+    auto const tau_D = model.time_for_instructions - model.time_forward_progress;
+    out.put(model.energy_consumed);
+    out.put(static_cast<int64_t>(model.num_backups));
+    out.put(static_cast<int64_t>(model.time_forward_progress));
+    out.put(static_cast<int64_t>(tau_D));
+    out.put(model.energy_forward_progress);
+    out.put(model.energy_for_backups);
+    out.put(model.energy_for_restore);
+
+    out.put(model.progress);
+    out.put(model.eh_progress);
   }
+
+  out.close();
 }
 
 int main(int argc, char *argv[])
 {
   argagg::parser arguments{{{"help", {"-h", "--help"}, "display help information", 0},
-      {"voltages", {"--voltage-trace"}, "path to voltage trace", 1},
-      {"rate", {"--voltage-rate"}, "sampling rate of voltage trace (microseconds)", 1},
+      {"voltages", {"--voltage-trace"}, "path to voltage trace (text or binary), - for stdin", 1},
+      {"source", {"--source"},
+          "synthetic power source instead of a trace: constant:V, square:LOW,HIGH,PERIOD,DUTY, "
+          "sine:OFFSET,AMPLITUDE,PERIOD, pwl:T0=V0,T1=V1,..., or bursts:SEED,RATE,DURATION,HIGH,LOW "
+          "(times in seconds, sampled every --voltage-rate)",
+          1},
+      {"stream", {"--stream-trace"}, "read the voltage trace forward instead of loading it", 0},
+      {"rate", {"--voltage-rate"},
+          "time between voltage trace samples (milliseconds, or with a ns/us/ms/s suffix)", 1},
       {"harvest", {"--always-harvest"}, "harvest during active periods", 1},
       {"scheme", {"--scheme"}, "the checkpointing scheme to use", 1},
-      {"tau_B", {"--tau-b"}, "the backup period for the parametric scheme", 1},
-      {"binary", {"-b", "--binary"}, "path to application binary", 1},
-      {"output", {"-o", "--output"}, "output file", 1}}};
+      {"tau_B", {"--tau-b"}, "the backup period for the parametric and undo-log schemes", 1},
+      {"adaptive", {"--adaptive-tau-b"},
+          "re-tune the backup period of the parametric scheme after every active period", 0},
+      {"dvfs", {"--dvfs"},
+          "scale the voltage and frequency of the clank and parametric schemes with the harvested "
+          "power",
+          0},
+      {"threshold", {"--threshold"},
+          "the voltage below which the mementos scheme checkpoints at trigger points", 1},
+      {"log_capacity", {"--log-capacity"}, "the entries in the log of the undo-log scheme", 1},
+      {"log_entry_energy", {"--log-entry-energy"},
+          "the energy to append to the log of the undo-log scheme (nJ)", 1},
+      {"commit_energy", {"--commit-energy"},
+          "the energy to commit the log of the undo-log scheme (nJ)", 1},
+      {"region", {"--memory-region"},
+          "a region of the address map, as sram, fram, mram, or flash:START:SIZE in bytes, which "
+          "can be repeated; sram loses its data when the power fails, which only the hibernus and "
+          "mementos schemes handle",
+          1},
+      {"binary", {"-b", "--binary"}, "path to application (ELF or raw binary)", 1},
+      {"native_helpers", {"--native-helpers"},
+          "execute the division, memcpy, and memset helpers of an ELF application natively", 0},
+      {"fast_loops", {"--fast-loops"},
+          "execute the iterations of copy, fill, delay, and SYSTICK polling loops at once", 0},
+      {"snapshot_at", {"--snapshot-at"},
+          "run without energy harvesting to an instruction count (or pc:0xADDRESS), then save a "
+          "snapshot to the output file",
+          1},
+      {"resume", {"--resume-from"}, "path to a snapshot to start the simulation from", 1},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"console", {"--console"},
+          "write the application's UART and semihosting output to this file, - for stdout", 1},
+      {"profile", {"--profile"}, "write a per-instruction hot-spot report to this file", 1},
+      {"call_graph", {"--call-graph"}, "write folded call stacks for flame graphs to this file", 1},
+      {"call_graph_weight", {"--call-graph-weight"},
+          "weight of the folded call stacks: cycles, energy (default), backup_energy, "
+          "wasted_cycles, or wasted_energy (energy in pJ)",
+          1},
+      {"stack_usage", {"--stack-usage"}, "write the stack high-water mark of every function", 1},
+      {"format", {"--output-format"}, "format of the output file: csv (default) or columnar", 1}}};
 
   try {
     auto const options = arguments.parse(argc, argv);
@@ -70,11 +290,67 @@ int main(int argc, char *argv[])
 
     validate(options);
 
-    auto const path_to_binary = options["binary"];
+    char const *path_to_binary = nullptr;
+    if(options["binary"].count() > 0) {
+      path_to_binary = options["binary"];
+    }
+
+    thumbulator::INTERCEPT_RUNTIME_HELPERS = options["native_helpers"].count() > 0;
+    thumbulator::ACCELERATE_LOOPS = options["fast_loops"].count() > 0;
+
+    bool volatile_memory = false;
+    for(auto const &region : options["region"].all) {
+      auto const parsed = parse_memory_region(region.as<std::string>());
+      thumbulator::add_memory_region(parsed);
+      volatile_memory = volatile_memory || parsed.is_volatile;
+    }
+
+    // console output is buffered by the simulator, and written out in large chunks
+    std::ofstream console_file;
+    if(options["console"].count() > 0) {
+      auto const path_to_console = options["console"].as<std::string>();
+      std::ostream *console = &std::cout;
+      if(path_to_console != "-") {
+        console_file.open(path_to_console, std::ios::binary);
+        if(!console_file.good()) {
+          throw std::runtime_error("Could not open console file: " + path_to_console);
+        }
+        console = &console_file;
+      }
+
+      thumbulator::console_flush_hook = [console](char const *data, size_t size) {
+        console->write(data, size);
+      };
+    }
+
+    if(options["snapshot_at"].count() > 0) {
+      auto const until = ehsim::parse_execution_point(options["snapshot_at"].as<std::string>());
+      auto const snapshot_file = options["output"].as<std::string>("snapshot.bin");
+
+      auto const warm_up = ehsim::fast_forward(path_to_binary, until, snapshot_file.c_str());
+      thumbulator::console_flush();
+
+      std::cout << "Warm-up instructions executed: " << warm_up.instruction_count << "\n";
+      std::cout << "Warm-up time (cycles): " << warm_up.cycle_count << "\n";
+      std::cout << "Snapshot saved to: " << snapshot_file << "\n";
+
+      return EXIT_SUCCESS;
+    }
+
+    char const *path_to_snapshot = nullptr;
+    if(options["resume"].count() > 0) {
+      path_to_snapshot = options["resume"];
+    }
+
     bool always_harvest = options["harvest"].as<int>(1) == 1;
 
-    auto const path_to_voltage_trace = options["voltages"];
-    std::chrono::milliseconds sampling_period(options["rate"]);
+    // binary traces know their own sample period
+    auto const sampling_period = parse_sample_period(options["rate"].as<std::string>("0"));
+
+    auto const output_format = options["format"].as<std::string>("csv");
+    if(output_format != "csv" && output_format != "columnar") {
+      throw std::runtime_error("Unknown output format: " + output_format);
+    }
 
     std::unique_ptr<ehsim::eh_scheme> scheme = nullptr;
     auto const scheme_select = options["scheme"].as<std::string>("bec");
@@ -85,17 +361,70 @@ int main(int argc, char *argv[])
     } else if(scheme_select == "magic") {
       throw std::runtime_error("Magic is no longer supported.");
     } else if(scheme_select == "clank") {
-      scheme = std::make_unique<ehsim::clank>();
+      scheme = std::make_unique<ehsim::clank>(options["dvfs"].count() > 0);
     } else if(scheme_select == "parametric") {
       auto const tau_b = options["tau_B"].as<int>(1000);
-      scheme = std::make_unique<ehsim::parametric>(tau_b);
+      auto const adaptive = options["adaptive"].count() > 0;
+      auto const dvfs = options["dvfs"].count() > 0;
+      scheme = std::make_unique<ehsim::parametric>(tau_b, adaptive, dvfs);
+    } else if(scheme_select == "undo-log") {
+      auto const tau_b = options["tau_B"].as<int>(1000);
+      auto const capacity = options["log_capacity"].as<uint64_t>(ehsim::UNDO_LOG_CAPACITY);
+      auto const entry_energy =
+          options["log_entry_energy"].as<double>(ehsim::UNDO_LOG_ENTRY_ENERGY);
+      auto const commit_energy = options["commit_energy"].as<double>(ehsim::UNDO_LOG_COMMIT_ENERGY);
+      scheme = std::make_unique<ehsim::undo_log>(tau_b, capacity, entry_energy, commit_energy);
+    } else if(scheme_select == "mementos") {
+      auto const threshold = options["threshold"].as<double>(ehsim::MEMENTOS_THRESHOLD_VOLTAGE);
+      scheme = std::make_unique<ehsim::mementos>(threshold);
+    } else if(scheme_select == "hibernus") {
+      scheme = std::make_unique<ehsim::hibernus>();
+    } else if(scheme_select == "oracle") {
+      scheme = std::make_unique<ehsim::oracle>();
     } else {
       throw std::runtime_error("Unknown scheme selected.");
     }
 
-    ehsim::voltage_trace power(path_to_voltage_trace, sampling_period);
+    // an option another scheme ignores would mislabel the run
+    if(options["adaptive"].count() > 0 && scheme_select != "parametric") {
+      throw std::runtime_error("--adaptive-tau-b needs the parametric scheme.");
+    }
 
-    auto const stats = ehsim::simulate(path_to_binary, power, scheme.get(), always_harvest);
+    if(options["dvfs"].count() > 0 && scheme_select != "clank" && scheme_select != "parametric") {
+      throw std::runtime_error("--dvfs needs the clank or parametric scheme.");
+    }
+
+    if(volatile_memory && !scheme->saves_volatile_memory()) {
+      throw std::runtime_error("The " + scheme_select + " scheme cannot run with volatile memory.");
+    }
+
+    std::unique_ptr<ehsim::energy_profile> profile = nullptr;
+    if(options["profile"].count() > 0) {
+      profile = std::make_unique<ehsim::energy_profile>();
+    }
+
+    std::unique_ptr<ehsim::call_graph_profile> call_graph = nullptr;
+    if(options["call_graph"].count() > 0 || options["stack_usage"].count() > 0) {
+      call_graph = std::make_unique<ehsim::call_graph_profile>();
+    }
+    auto const call_graph_weight =
+        ehsim::parse_call_graph_weight(options["call_graph_weight"].as<std::string>("energy"));
+
+    std::unique_ptr<ehsim::power_source> power = nullptr;
+    if(options["source"].count() > 0) {
+      // synthetic sources are sampled every millisecond unless asked otherwise
+      auto const source_period =
+          sampling_period.count() != 0 ? sampling_period : std::chrono::milliseconds(1);
+      power = ehsim::make_synthetic_source(options["source"].as<std::string>(), source_period);
+    } else {
+      power = std::make_unique<ehsim::voltage_trace>(options["voltages"].as<std::string>(),
+          sampling_period, options["stream"].count() > 0);
+    }
+
+    auto const stats = ehsim::simulate(
+        path_to_binary, *power, scheme.get(), always_harvest, path_to_snapshot, profile.get(),
+        call_graph.get());
+    thumbulator::console_flush();
 
     std::cout << "CPU instructions executed: " << stats.cpu.instruction_count << "\n";
     std::cout << "CPU time (cycles): " << stats.cpu.cycle_count << "\n";
@@ -103,38 +432,40 @@ int main(int argc, char *argv[])
     std::cout << "Energy harvested (J): " << stats.system.energy_harvested * 1e-9 << "\n";
     std::cout << "Energy remaining (J): " << stats.system.energy_remaining * 1e-9 << "\n";
 
-    std::string output_file_name(scheme_select + ".csv");
+    if(stats.fault.faulted) {
+      std::cerr << "Fault: " << stats.fault.reason << "\n";
+    }
+
+    std::string output_file_name(scheme_select + (output_format == "csv" ? ".csv" : ".ehc"));
     if(options["output"].count() > 0) {
       output_file_name = options["output"].as<std::string>();
     }
 
-    std::ofstream out(output_file_name);
-    out.setf(std::ios::fixed);
-    out << "id, E, epsilon, epsilon_C, tau_B, alpha_B, energy_consumed, n_B, tau_P, tau_D, e_P, e_B, "
-           "e_R, sim_p, eh_p\n";
-
-    int id = 0;
-    for(auto const &model : stats.models) {
-      out << id++ << ", ";
-
-      auto const eh_parameters = ehsim::eh_model_parameters(model);
-      out << std::setprecision(3) << eh_parameters.E << ", ";
-      out << std::setprecision(3) << eh_parameters.epsilon << ", ";
-      out << std::setprecision(3) << eh_parameters.epsilon_C << ", ";
-      out << std::setprecision(2) << eh_parameters.tau_B << ", ";
-      out << std::setprecision(4) << eh_parameters.alpha_B << ", ";
-
-      auto const tau_D = model.time_for_instructions - model.time_forward_progress;
-      out << std::setprecision(3) << model.energy_consumed << ", ";
-      out << std::setprecision(0) << model.num_backups << ", ";
-      out << std::setprecision(0) << model.time_forward_progress << ", ";
-      out << std::setprecision(0) << tau_D << ", ";
-      out << std::setprecision(3) << model.energy_forward_progress << ", ";
-      out << std::setprecision(3) << model.energy_for_backups << ", ";
-      out << std::setprecision(3) << model.energy_for_restore << ", ";
-
-      out << std::setprecision(3) << model.progress << ", ";
-      out << std::setprecision(3) << model.eh_progress << "\n";
+    if(output_format == "csv") {
+      write_csv(stats, output_file_name);
+    } else {
+      write_columnar(stats, output_file_name);
+    }
+
+    // a snapshot does not keep the symbols, so only a binary can name functions
+    auto const symbols = path_to_binary != nullptr && (profile != nullptr || call_graph != nullptr)
+                             ? thumbulator::read_symbols(path_to_binary)
+                             : thumbulator::symbol_table();
+
+    if(profile != nullptr) {
+      profile->write_report(options["profile"].as<std::string>(), symbols);
+    }
+
+    if(options["call_graph"].count() > 0) {
+      call_graph->write_folded(options["call_graph"].as<std::string>(), symbols, call_graph_weight);
+    }
+
+    if(options["stack_usage"].count() > 0) {
+      call_graph->write_stack_usage(options["stack_usage"].as<std::string>(), symbols);
+    }
+
+    if(stats.fault.faulted) {
+      return EXIT_FAILURE;
     }
   } catch(std::exception const &e) {
     std::cerr << "Error: " << e.what() << "\n";
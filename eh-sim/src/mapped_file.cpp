@@ -0,0 +1,42 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace ehsim {
+
+mapped_file::mapped_file(std::string const &path_to_file)
+    : address(nullptr)
+    , length(0)
+{
+  auto const fd = open(path_to_file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    throw std::runtime_error("Could not open file: " + path_to_file);
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("Could not map empty file: " + path_to_file);
+  }
+
+  length = static_cast<size_t>(info.st_size);
+  address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if(address == MAP_FAILED) {
+    throw std::runtime_error("Could not map file: " + path_to_file);
+  }
+}
+
+mapped_file::~mapped_file()
+{
+  munmap(address, length);
+}
+}
@@ -0,0 +1,44 @@
+#ifndef EH_SIM_MAPPED_FILE_HPP
+#define EH_SIM_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace ehsim {
+
+/**
+ * A read-only memory mapping of a file.
+ *
+ * The pages are shared with every other process that maps the same file.
+ */
+class mapped_file {
+public:
+  /**
+   * Constructor.
+   *
+   * @param path_to_file The file to map.
+   */
+  explicit mapped_file(std::string const &path_to_file);
+
+  ~mapped_file();
+
+  mapped_file(mapped_file const &) = delete;
+  mapped_file &operator=(mapped_file const &) = delete;
+
+  void const *data() const
+  {
+    return address;
+  }
+
+  size_t size() const
+  {
+    return length;
+  }
+
+private:
+  void *address;
+  size_t length;
+};
+}
+
+#endif //EH_SIM_MAPPED_FILE_HPP
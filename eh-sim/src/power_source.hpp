@@ -0,0 +1,48 @@
+#ifndef EH_SIM_POWER_SOURCE_HPP
+#define EH_SIM_POWER_SOURCE_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace ehsim {
+
+/**
+ * An abstract power supply, read through a cursor that moves forward one sample at a time.
+ *
+ * Sources with precomputed or closed-form energy let the cursor skip a span of samples without
+ * reading them.
+ */
+class power_source {
+public:
+  virtual ~power_source() = default;
+
+  /**
+   * @return The voltage of the sample under the cursor.
+   */
+  virtual double voltage() const = 0;
+
+  /**
+   * Move the cursor to the next sample.
+   */
+  virtual void advance() = 0;
+
+  virtual std::chrono::nanoseconds sample_period() const = 0;
+
+  /**
+   * @return The number of samples the cursor can skip, or zero if it cannot skip from here.
+   */
+  virtual uint64_t skippable_samples() const = 0;
+
+  /**
+   * @return The integral of the voltage over the skippable samples, in volt-seconds.
+   */
+  virtual double skippable_energy() const = 0;
+
+  /**
+   * Move the cursor past the skippable samples, without reading them.
+   */
+  virtual void skip() = 0;
+};
+}
+
+#endif //EH_SIM_POWER_SOURCE_HPP
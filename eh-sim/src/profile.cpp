@@ -0,0 +1,79 @@
+#include "profile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <stdexcept>
+
+namespace ehsim {
+
+energy_profile::energy_profile()
+    : energies(static_cast<pc_energy *>(std::calloc(thumbulator::execution_profile::ENTRIES,
+                   sizeof(pc_energy))),
+          &std::free)
+{
+  if(energies == nullptr) {
+    throw std::bad_alloc();
+  }
+}
+
+void energy_profile::backup()
+{
+  for(auto const index : dirty) {
+    auto &entry = energies[index];
+    entry.energy_at_backup = entry.energy;
+    entry.dirty = false;
+  }
+
+  dirty.clear();
+}
+
+void energy_profile::power_off()
+{
+  for(auto const index : dirty) {
+    auto &entry = energies[index];
+    entry.wasted += entry.energy - entry.energy_at_backup;
+    entry.energy_at_backup = entry.energy;
+    entry.dirty = false;
+  }
+
+  dirty.clear();
+}
+
+void energy_profile::write_report(std::string const &path_to_report,
+    thumbulator::symbol_table const &symbols) const
+{
+  std::ofstream out(path_to_report);
+  if(!out.good()) {
+    throw std::runtime_error("Could not open profile report: " + path_to_report);
+  }
+
+  auto hot_spots = executions.hot_spots();
+  auto const energy_of = [this](uint32_t address) {
+    return energies[(address - FLASH_START) >> 1].energy;
+  };
+
+  std::stable_sort(hot_spots.begin(), hot_spots.end(),
+      [&energy_of](std::pair<uint32_t, thumbulator::pc_counters> const &a,
+          std::pair<uint32_t, thumbulator::pc_counters> const &b) {
+        return energy_of(a.first) > energy_of(b.first);
+      });
+
+  out << "pc, function, executions, cycles, energy, wasted_energy\n";
+  out.setf(std::ios::fixed);
+  for(auto const &spot : hot_spots) {
+    auto const &energy = energies[(spot.first - FLASH_START) >> 1];
+
+    out << "0x" << std::hex << std::setw(8) << std::setfill('0') << spot.first << std::dec << ", ";
+
+    auto const function = symbols.function_at(spot.first);
+    out << (function != nullptr ? function->name : "?") << ", ";
+
+    out << spot.second.executions << ", ";
+    out << spot.second.cycles << ", ";
+    out << std::setprecision(3) << energy.energy << ", ";
+    out << std::setprecision(3) << energy.wasted << "\n";
+  }
+}
+}
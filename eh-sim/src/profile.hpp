@@ -0,0 +1,86 @@
+#ifndef EH_SIM_PROFILE_HPP
+#define EH_SIM_PROFILE_HPP
+
+#include <thumbulator/profile.hpp>
+#include <thumbulator/program.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * Attributes execution, energy, and wasted work to the instructions of the application.
+ *
+ * Work is wasted when the device powers off before backing it up, so it is executed again after
+ * the next restore.
+ */
+class energy_profile {
+public:
+  energy_profile();
+
+  /**
+   * Count an execution of the instruction at an address.
+   *
+   * @param address The address of the instruction.
+   * @param cycles The number of cycles the instruction took.
+   * @param energy The energy the instruction consumed (nJ).
+   */
+  void record(uint32_t address, uint32_t cycles, double energy)
+  {
+    executions.record(address, cycles);
+
+    auto const index = (address - FLASH_START) >> 1;
+    if(index < thumbulator::execution_profile::ENTRIES) {
+      auto &entry = energies[index];
+      entry.energy += energy;
+
+      if(!entry.dirty) {
+        entry.dirty = true;
+        dirty.push_back(index);
+      }
+    }
+  }
+
+  /**
+   * The work executed so far is safe.
+   */
+  void backup();
+
+  /**
+   * The work executed since the last backup is lost, and will be executed again.
+   */
+  void power_off();
+
+  /**
+   * Write the profile of every executed instruction, with the most energy first.
+   *
+   * @param path_to_report The file to write.
+   * @param symbols The symbols of the application, to name the function of every instruction.
+   */
+  void write_report(std::string const &path_to_report,
+      thumbulator::symbol_table const &symbols) const;
+
+private:
+  struct pc_energy {
+    double energy;
+    double wasted;
+
+    // the energy at the last backup, and whether it executed since
+    double energy_at_backup;
+    bool dirty;
+  };
+
+  thumbulator::execution_profile executions;
+
+  std::unique_ptr<pc_energy[], decltype(&std::free)> energies;
+
+  // the instructions executed since the last backup
+  std::vector<uint32_t> dirty;
+};
+}
+
+#endif //EH_SIM_PROFILE_HPP
@@ -47,6 +47,25 @@ public:
     stats->models.back().energy_for_instructions += NVP_INSTRUCTION_ENERGY;
   }
 
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    auto required_energy = NVP_INSTRUCTION_ENERGY + NVP_BEC_BACKUP_ENERGY;
+
+    if(stats->cpu.instruction_count != 0) {
+      required_energy += NVP_BEC_RESTORE_ENERGY;
+    }
+
+    // sleep until the device would power off
+    cycles = cycles_to_sleep(battery.energy_stored(), required_energy, NVP_SLEEP_ENERGY, cycles);
+
+    auto const sleep_energy = NVP_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
   bool is_active(stats_bundle *stats) override
   {
     auto required_energy = NVP_INSTRUCTION_ENERGY + NVP_BEC_BACKUP_ENERGY;
@@ -3,6 +3,7 @@
 
 #include "scheme/eh_scheme.hpp"
 #include "scheme/data_sheet.hpp"
+#include "scheme/dvfs.hpp"
 #include "capacitor.hpp"
 #include "stats.hpp"
 
@@ -23,13 +24,16 @@ class clank : public eh_scheme {
 public:
   /**
    * Construct a default clank configuration.
+   *
+   * @param dvfs Scale the voltage and frequency with the harvested power.
    */
-  clank() : clank(8, 8, 8000)
+  explicit clank(bool dvfs = false) : clank(8, 8, 8000, dvfs)
   {
   }
 
-  clank(size_t rf_entries, size_t wf_entries, int watchdog_period)
+  clank(size_t rf_entries, size_t wf_entries, int watchdog_period, bool dvfs)
       : battery(NVP_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
+      , governor(dvfs)
       , WATCHDOG_PERIOD(watchdog_period)
       , READFIRST_ENTRIES(rf_entries)
       , WRITEFIRST_ENTRIES(wf_entries)
@@ -53,7 +57,7 @@ public:
 
   uint32_t clock_frequency() const override
   {
-    return CORTEX_M0PLUS_FREQUENCY;
+    return governor.frequency();
   }
 
   double min_energy_to_power_on(stats_bundle *stats) override
@@ -69,11 +73,65 @@ public:
     progress_watchdog -= elapsed_cycles;
 
     // clank's instruction energy is in Energy-per-Cycle
-    auto const instruction_energy = CLANK_INSTRUCTION_ENERGY * elapsed_cycles;
+    auto const instruction_energy = governor.scale(CLANK_INSTRUCTION_ENERGY) * elapsed_cycles;
     battery.consume_energy(instruction_energy);
     stats->models.back().energy_for_instructions += instruction_energy;
   }
 
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    // the energy of every cycle since the last instruction is charged at once
+    if(count > 0) {
+      execute_instruction(stats);
+    }
+  }
+
+  void hypercall(
+      stats_bundle *stats, thumbulator::hypercall call, uint32_t r0, uint32_t r1) override
+  {
+    // a requested checkpoint is taken like one of the watchdog
+    if(call == thumbulator::hypercall::checkpoint) {
+      progress_watchdog = 0;
+    }
+  }
+
+  void harvested_power(stats_bundle *stats, double power) override
+  {
+    governor.select(power, CLANK_INSTRUCTION_ENERGY);
+  }
+
+  double memory_access_energy(double energy) const override
+  {
+    return governor.scale(energy);
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    // an idempotency violation in the run is only backed up after it
+    auto const energy = governor.scale(CLANK_INSTRUCTION_ENERGY) * cycles;
+
+    return progress_watchdog > static_cast<int64_t>(cycles)
+           && battery.energy_stored() >= energy + MAX_BACKUP_ENERGY;
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // the watchdog keeps counting while the CPU sleeps
+    cycles = std::min<uint64_t>(cycles, std::max(progress_watchdog, 1));
+    cycles = cycles_to_sleep(
+        battery.energy_stored(), MAX_BACKUP_ENERGY, governor.scale(CLANK_SLEEP_ENERGY), cycles);
+
+    progress_watchdog -= static_cast<int>(cycles);
+    last_tick += cycles;
+
+    auto const sleep_energy = governor.scale(CLANK_SLEEP_ENERGY) * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
   bool is_active(stats_bundle *stats) override
   {
     if(battery.energy_stored() >= battery.maximum_energy_stored()) {
@@ -146,6 +204,7 @@ public:
 
 private:
   capacitor battery;
+  dvfs_governor governor;
 
   uint64_t last_backup_cycle = 0u;
   uint64_t last_tick = 0u;
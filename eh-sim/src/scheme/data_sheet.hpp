@@ -1,6 +1,8 @@
 #ifndef EH_SIM_DATA_SHEET_ENERGY_HPP
 #define EH_SIM_DATA_SHEET_ENERGY_HPP
 
+#include <cstdint>
+
 namespace ehsim {
 
 // all energy units are in nJ
@@ -64,12 +66,71 @@ constexpr double CORTEX_M0PLUS_VOLTAGE = 1.8;
 // this includes the fetching of the instruction
 constexpr double CORTEX_M0PLUS_INSTRUCTION_ENERGY_PER_CYCLE =
     1e9 * (CORTEX_M0PLUS_CURRENT * CORTEX_M0PLUS_VOLTAGE) / CORTEX_M0PLUS_FREQUENCY;
+// sleep mode at the same frequency, the CPU clock stops while the peripherals keep running
+constexpr double CORTEX_M0PLUS_SLEEP_CURRENT = 0.3e-3;
+constexpr double CORTEX_M0PLUS_SLEEP_ENERGY_PER_CYCLE =
+    1e9 * (CORTEX_M0PLUS_SLEEP_CURRENT * CORTEX_M0PLUS_VOLTAGE) / CORTEX_M0PLUS_FREQUENCY;
 // Table 43 - energy per byte
 constexpr double CORTEX_M0PLUS_ENERGY_FLASH = 1e9 * 0.7e-6 * 3.6 * 3.94e-3;
 
+/**
+ * A clock frequency and the core voltage it runs at.
+ */
+struct operating_point {
+  uint32_t frequency;
+  double voltage;
+};
+
+// the data sheet numbers above are for this operating point
+constexpr operating_point CORTEX_M0PLUS_NOMINAL_POINT{
+    CORTEX_M0PLUS_FREQUENCY, CORTEX_M0PLUS_VOLTAGE};
+// Table 17 - the core runs at 1.2 V up to 4.2 MHz, at 1.5 V up to 16 MHz, and at 1.8 V up to 32 MHz
+constexpr operating_point CORTEX_M0PLUS_OPERATING_POINTS[] = {{1000000, 1.2}, {2000000, 1.2},
+    {4000000, 1.2}, {8000000, 1.5}, {16000000, 1.5}, {32000000, 1.8}};
+
+/**
+ * The energy per cycle at an operating point, relative to the nominal one.
+ *
+ * The dynamic energy of a cycle scales with the square of the voltage.
+ */
+constexpr double operating_point_energy_scale(operating_point const &point)
+{
+  return (point.voltage * point.voltage) / (CORTEX_M0PLUS_VOLTAGE * CORTEX_M0PLUS_VOLTAGE);
+}
+
+/**
+ * The costs of a memory technology that regions of the address map can be built from.
+ *
+ * Latencies are in cycles at the nominal operating point, and energies are per 32-bit access, on
+ * top of the instruction's.
+ */
+struct memory_technology {
+  uint32_t read_latency;
+  uint32_t write_latency;
+  double read_energy;
+  double write_energy;
+  bool is_volatile;
+};
+
+// SRAM is the memory the instruction energy above already includes
+constexpr memory_technology SRAM_TECHNOLOGY{0, 0, 0.0, 0.0, true};
+// FRAM reads are destructive and write back, so reads cost as much as writes
+constexpr memory_technology FRAM_TECHNOLOGY{
+    1, 1, CORTEX_M0PLUS_ENERGY_FLASH * 4, CORTEX_M0PLUS_ENERGY_FLASH * 4, false};
+// STT-MRAM reads like SRAM, but switching the cells makes writes slow and costly
+constexpr memory_technology MRAM_TECHNOLOGY{0, 4, 0.0, CORTEX_M0PLUS_ENERGY_FLASH * 4 * 3, false};
+// Table 43 - programming flash, which reads with a wait state
+constexpr memory_technology FLASH_TECHNOLOGY{
+    1, 8, CORTEX_M0PLUS_ENERGY_FLASH, CORTEX_M0PLUS_ENERGY_FLASH * 4, false};
+
+// the NVP paper has no sleep mode, so scale its instruction energy like the M0+ current
+constexpr double NVP_SLEEP_ENERGY =
+    NVP_INSTRUCTION_ENERGY * CORTEX_M0PLUS_SLEEP_CURRENT / CORTEX_M0PLUS_CURRENT;
+
 // based on Clank: Architectural Support for Intermittent Computation
 constexpr uint64_t CLANK_BACKUP_ARCH_TIME = 40;
 constexpr double CLANK_INSTRUCTION_ENERGY = CORTEX_M0PLUS_INSTRUCTION_ENERGY_PER_CYCLE;
+constexpr double CLANK_SLEEP_ENERGY = CORTEX_M0PLUS_SLEEP_ENERGY_PER_CYCLE;
 constexpr double CLANK_BACKUP_ARCH_ENERGY = CORTEX_M0PLUS_ENERGY_FLASH * 4 * 20;
 constexpr double CLANK_RESTORE_ENERGY = CORTEX_M0PLUS_ENERGY_FLASH * 4 * 20;
 constexpr uint64_t CLANK_MEMORY_TIME = 2;
@@ -88,6 +149,69 @@ constexpr auto PARAMETRIC_OMEGA_B = CLANK_OMEGA_B;
 constexpr auto PARAMETRIC_A_R = 80; // 20 32-bit registers
 constexpr auto PARAMETRIC_SIGMA_R = CLANK_SIGMA_R;
 constexpr auto PARAMETRIC_OMEGA_R = CLANK_OMEGA_R;
+// the adaptive parametric scheme searches the backup periods swept by scripts/run_parametric.py
+constexpr int PARAMETRIC_MIN_TAU_B = 250;
+constexpr int PARAMETRIC_MAX_TAU_B = 3000;
+constexpr int PARAMETRIC_TAU_B_STEP = 10;
+
+// the oracle backs up before a step as long as a pop into the PC that takes an exception
+constexpr uint64_t ORACLE_LONGEST_STEP = 32;
+
+// an undo log in non-volatile memory, each entry holds an address and the value it had
+constexpr uint64_t UNDO_LOG_CAPACITY = 512;
+constexpr double UNDO_LOG_ENTRY_ENERGY = CORTEX_M0PLUS_ENERGY_FLASH * 4 * 2;
+constexpr uint64_t UNDO_LOG_ENTRY_TIME = CLANK_MEMORY_TIME;
+// a commit truncates the log by writing its head
+constexpr double UNDO_LOG_COMMIT_ENERGY = CORTEX_M0PLUS_ENERGY_FLASH * 4;
+constexpr uint64_t UNDO_LOG_COMMIT_TIME = CLANK_MEMORY_TIME;
+// the words a step can store: a push of every register, then the context stacked by an exception
+constexpr uint64_t UNDO_LOG_STEP_STORES = 9 + 8;
+
+constexpr auto UNDO_LOG_A_B = 80; // 20 32-bit registers
+constexpr auto UNDO_LOG_SIGMA_B = CLANK_SIGMA_B;
+constexpr auto UNDO_LOG_OMEGA_B = CLANK_OMEGA_B;
+constexpr auto UNDO_LOG_A_R = 80; // 20 32-bit registers
+constexpr auto UNDO_LOG_SIGMA_R = CLANK_SIGMA_R;
+constexpr auto UNDO_LOG_OMEGA_R = CLANK_OMEGA_R;
+
+// Mementos checkpoints to the MSP430's flash, which moves 16 bits at a time
+constexpr uint32_t MEMENTOS_MOVES_PER_WORD = 2;
+// r0-r15 and xPSR
+constexpr uint32_t MEMENTOS_ARCH_WORDS = 17;
+// a flash write takes 35 cycles of the flash timing generator (~400 kHz), reads take 2 CPU cycles
+constexpr uint64_t MEMENTOS_FLASH_WRITE_TIME = 700;
+constexpr uint64_t MEMENTOS_FLASH_READ_TIME = 2;
+// trigger points checkpoint below this voltage
+constexpr double MEMENTOS_THRESHOLD_VOLTAGE = 4.0;
+constexpr double MEMENTOS_SLEEP_ENERGY =
+    MEMENTOS_INSTRUCTION_ENERGY * CORTEX_M0PLUS_SLEEP_CURRENT / CORTEX_M0PLUS_CURRENT;
+
+// EH Model Parameters
+constexpr auto MEMENTOS_A_B = MEMENTOS_ARCH_WORDS * 4;
+constexpr auto MEMENTOS_SIGMA_B = 2.0 / MEMENTOS_FLASH_WRITE_TIME;
+constexpr auto MEMENTOS_OMEGA_B = MEMENTOS_FLASH_REG / 2;
+constexpr auto MEMENTOS_A_R = MEMENTOS_ARCH_WORDS * 4;
+constexpr auto MEMENTOS_SIGMA_R = 2.0 / MEMENTOS_FLASH_READ_TIME;
+constexpr auto MEMENTOS_OMEGA_R = MEMENTOS_REG_FLASH / 2;
+
+// based on Hibernus: Sustaining Computation during Intermittent Supply for Energy-Harvesting
+// Systems
+// a snapshot copies every page of RAM the application touched, one word at a time
+constexpr uint32_t HIBERNUS_PAGE_SIZE = 256;
+constexpr double HIBERNUS_PAGE_ENERGY = CORTEX_M0PLUS_ENERGY_FLASH * HIBERNUS_PAGE_SIZE;
+constexpr uint64_t HIBERNUS_PAGE_TIME = CLANK_MEMORY_TIME * HIBERNUS_PAGE_SIZE / 4;
+// the snapshot is taken with room for a step that touches a new page, like the oracle's backup
+constexpr auto HIBERNUS_LONGEST_STEP = ORACLE_LONGEST_STEP;
+// the voltage comparator restores this far above the voltage that covers the restore itself
+constexpr double HIBERNUS_RESTORE_HYSTERESIS = 1.0;
+
+// EH Model Parameters
+constexpr auto HIBERNUS_A_B = CLANK_A_B;
+constexpr auto HIBERNUS_SIGMA_B = CLANK_SIGMA_B;
+constexpr auto HIBERNUS_OMEGA_B = CLANK_OMEGA_B;
+constexpr auto HIBERNUS_A_R = CLANK_A_R;
+constexpr auto HIBERNUS_SIGMA_R = CLANK_SIGMA_R;
+constexpr auto HIBERNUS_OMEGA_R = CLANK_OMEGA_R;
 }
 
 #endif //EH_SIM_DATA_SHEET_ENERGY_HPP
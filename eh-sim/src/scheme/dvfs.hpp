@@ -0,0 +1,68 @@
+#ifndef EH_SIM_DVFS_HPP
+#define EH_SIM_DVFS_HPP
+
+#include "scheme/data_sheet.hpp"
+
+#include <cstdint>
+
+namespace ehsim {
+
+/**
+ * Dynamic voltage and frequency scaling of a Cortex-M0+.
+ *
+ * Runs at the fastest operating point that the harvested power sustains, so the capacitor drains
+ * as slowly as the application allows. Without DVFS, the core stays at the nominal operating point.
+ */
+class dvfs_governor {
+public:
+  explicit dvfs_governor(bool enabled) : ENABLED(enabled), point(CORTEX_M0PLUS_NOMINAL_POINT)
+  {
+  }
+
+  uint32_t frequency() const
+  {
+    return point.frequency;
+  }
+
+  /**
+   * Scale an energy per cycle at the nominal operating point to the current one.
+   */
+  double scale(double energy_per_cycle) const
+  {
+    return energy_per_cycle * energy_scale;
+  }
+
+  /**
+   * Pick the operating point for the harvested power.
+   *
+   * @param harvested_power The power charging the capacitor in nJ per second.
+   * @param energy_per_cycle The energy per cycle at the nominal operating point in nJ.
+   */
+  void select(double harvested_power, double energy_per_cycle)
+  {
+    if(!ENABLED) {
+      return;
+    }
+
+    // the slowest operating point runs even if the capacitor drains
+    point = CORTEX_M0PLUS_OPERATING_POINTS[0];
+    for(auto const &candidate : CORTEX_M0PLUS_OPERATING_POINTS) {
+      auto const power =
+          energy_per_cycle * operating_point_energy_scale(candidate) * candidate.frequency;
+      if(power <= harvested_power) {
+        point = candidate;
+      }
+    }
+
+    energy_scale = operating_point_energy_scale(point);
+  }
+
+private:
+  bool const ENABLED;
+
+  operating_point point;
+  double energy_scale = 1.0;
+};
+}
+
+#endif //EH_SIM_DVFS_HPP
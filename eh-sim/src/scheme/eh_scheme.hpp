@@ -1,6 +1,11 @@
 #ifndef EH_SIM_SCHEME_HPP
 #define EH_SIM_SCHEME_HPP
 
+#include <thumbulator/hypercall.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
 namespace ehsim {
 
 class capacitor;
@@ -14,6 +19,9 @@ class eh_scheme {
 public:
   virtual capacitor &get_battery() = 0;
 
+  /**
+   * The clock frequency of the current operating point in Hz, which can change at run time.
+   */
   virtual uint32_t clock_frequency() const = 0;
 
   virtual double min_energy_to_power_on(stats_bundle *stats) = 0;
@@ -29,7 +37,123 @@ public:
   virtual uint64_t restore(stats_bundle *stats) = 0;
 
   virtual double estimate_progress(eh_model_parameters const &) const = 0;
+
+  /**
+   * Execute a run of instructions at once, like a runtime helper executed natively or the
+   * iterations of a loop.
+   *
+   * Schemes that charge every instruction alike should consume the energy of the run at once.
+   *
+   * @param count The number of instructions in the run.
+   */
+  virtual void execute_instructions(stats_bundle *stats, uint64_t count)
+  {
+    for(uint64_t i = 0; i < count; ++i) {
+      execute_instruction(stats);
+    }
+  }
+
+  /**
+   * Sleep while the CPU waits in wfi or wfe, consuming the energy of sleeping instead of executing.
+   *
+   * The sleep ends early at the cycle the scheme must back up or power off in.
+   *
+   * @param cycles The cycles until the CPU wakes up or the harvested power changes, at least one.
+   *
+   * @return The cycles slept, at least one.
+   */
+  virtual uint64_t sleep(stats_bundle *stats, uint64_t cycles) = 0;
+
+  /**
+   * Handle a hypercall of the application, like a task boundary or a request for a checkpoint.
+   *
+   * A scheme that backs up in response should do so the next time will_backup is asked.
+   *
+   * @param call The hypercall.
+   * @param r0 The first argument.
+   * @param r1 The second argument.
+   */
+  virtual void hypercall(stats_bundle *stats, thumbulator::hypercall call, uint32_t r0, uint32_t r1)
+  {
+  }
+
+  /**
+   * Called when the harvested power changes, so the scheme can pick another operating point.
+   *
+   * @param power The power charging the capacitor in nJ per second.
+   */
+  virtual void harvested_power(stats_bundle *stats, double power)
+  {
+  }
+
+  /**
+   * The energy the scheme consumes for loads and stores to the regions of the address map.
+   *
+   * @param energy The energy of the accesses at the nominal operating point.
+   */
+  virtual double memory_access_energy(double energy) const
+  {
+    return energy;
+  }
+
+  /**
+   * Whether the scheme saves and restores the data of volatile memory regions.
+   *
+   * Schemes that assume all memory is non-volatile give wrong results when a region loses its data.
+   */
+  virtual bool saves_volatile_memory() const
+  {
+    return false;
+  }
+
+  /**
+   * Called after the application branched backwards, like at the end of a loop iteration.
+   *
+   * @param address The address of the branch.
+   */
+  virtual void back_edge(stats_bundle *stats, uint32_t address)
+  {
+  }
+
+  /**
+   * Check if a run of instructions can execute at once, like a runtime helper executed natively.
+   *
+   * The run must end before the next backup and before the device runs out of energy, because
+   * neither can happen in the middle of it. Schemes that cannot tell execute every instruction.
+   *
+   * @param instructions The number of instructions in the run.
+   * @param cycles The number of cycles the run takes.
+   */
+  virtual bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles)
+  {
+    return false;
+  }
 };
+
+/**
+ * The cycles a scheme can sleep for before its stored energy drops to a reserve.
+ *
+ * @param energy The energy stored.
+ * @param reserve The energy the scheme must keep to back up or to stay powered on.
+ * @param energy_per_cycle The energy consumed by each cycle of sleep.
+ * @param cycles The cycles until the CPU wakes up.
+ *
+ * @return The cycles to sleep for, at least one.
+ */
+inline uint64_t cycles_to_sleep(
+    double energy, double reserve, double energy_per_cycle, uint64_t cycles)
+{
+  if(energy <= reserve) {
+    return 1;
+  }
+
+  auto const affordable = (energy - reserve) / energy_per_cycle;
+  if(affordable >= static_cast<double>(cycles)) {
+    return cycles;
+  }
+
+  return std::max<uint64_t>(1, static_cast<uint64_t>(affordable));
+}
 }
 
 #endif //EH_SIM_SCHEME_HPP
@@ -0,0 +1,280 @@
+#ifndef EH_SIM_HIBERNUS_HPP
+#define EH_SIM_HIBERNUS_HPP
+
+#include "scheme/eh_scheme.hpp"
+#include "scheme/data_sheet.hpp"
+#include "scheme/eh_model.hpp"
+#include "capacitor.hpp"
+#include "stats.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/exception.hpp>
+#include <thumbulator/memory.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * Based on Hibernus: Sustaining Computation during Intermittent Supply for Energy-Harvesting
+ * Systems.
+ *
+ * The application runs without any backups until the capacitor falls to the hibernate threshold,
+ * when a single snapshot of the registers and RAM is taken and the device hibernates. It is
+ * restored once the capacitor recovers above the restore threshold.
+ */
+class hibernus : public eh_scheme {
+public:
+  hibernus()
+      : battery(MEMENTOS_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
+      , touched(RAM_SIZE_BYTES / HIBERNUS_PAGE_SIZE, false)
+  {
+    thumbulator::ram_store_hook = [this](uint32_t address, uint32_t last_value,
+        uint32_t value) -> uint32_t { return this->process_store(address, last_value, value); };
+  }
+
+  capacitor &get_battery() override
+  {
+    return battery;
+  }
+
+  uint32_t clock_frequency() const override
+  {
+    return MEMENTOS_CPU_FREQUENCY;
+  }
+
+  bool saves_volatile_memory() const override
+  {
+    return true;
+  }
+
+  double min_energy_to_power_on(stats_bundle *stats) override
+  {
+    return restore_threshold();
+  }
+
+  void execute_instruction(stats_bundle *stats) override
+  {
+    execute_instructions(stats, 1);
+  }
+
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    auto const instruction_energy = CLANK_INSTRUCTION_ENERGY * count;
+    battery.consume_energy(instruction_energy);
+    stats->models.back().energy_for_instructions += instruction_energy;
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // sleep until the hibernate threshold
+    cycles = cycles_to_sleep(
+        battery.energy_stored(), hibernate_threshold(), CLANK_SLEEP_ENERGY, cycles);
+
+    auto const sleep_energy = CLANK_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    auto const energy = instructions * CLANK_INSTRUCTION_ENERGY;
+
+    return battery.energy_stored() >= energy + hibernate_threshold();
+  }
+
+  bool is_active(stats_bundle *stats) override
+  {
+    if(!active && battery.energy_stored() >= restore_threshold()) {
+      power_on();
+    } else if(active && battery.energy_stored() < CLANK_INSTRUCTION_ENERGY) {
+      // the power fails if the snapshot was too large for the energy left
+      active = false;
+    }
+
+    return active;
+  }
+
+  bool will_backup(stats_bundle *stats) const override
+  {
+    return battery.energy_stored() <= hibernate_threshold();
+  }
+
+  uint64_t backup(stats_bundle *stats) override
+  {
+    auto &active_stats = stats->models.back();
+
+    // hibernate until the restore threshold
+    active = false;
+
+    // a snapshot that cannot finish is lost with the power, and the previous one is kept
+    auto const backup_energy = snapshot_energy();
+    if(battery.energy_stored() < backup_energy) {
+      active_stats.energy_for_backups += battery.energy_stored();
+      battery.consume_energy(battery.energy_stored());
+
+      return 0;
+    }
+
+    active_stats.num_backups++;
+
+    auto const tau_B = stats->cpu.cycle_count - last_backup_cycle;
+    active_stats.time_between_backups += tau_B;
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    active_stats.energy_for_backups += backup_energy;
+    battery.consume_energy(backup_energy);
+
+    // save architectural state, including the peripherals
+    thumbulator::systick_update();
+    architectural_state = thumbulator::cpu;
+    systick = thumbulator::SYSTICK;
+    sleeping = thumbulator::CPU_IS_SLEEPING;
+    event_register = thumbulator::EVENT_REGISTER;
+
+    // save application state
+    snapshot.clear();
+    for(auto const page : pages) {
+      auto const begin = thumbulator::RAM + page * HIBERNUS_PAGE_SIZE / 4;
+      snapshot.insert(snapshot.end(), begin, begin + HIBERNUS_PAGE_SIZE / 4);
+    }
+    snapshot_pages = pages.size();
+    has_snapshot = true;
+
+    active_stats.bytes_application +=
+        static_cast<double>(snapshot_pages * HIBERNUS_PAGE_SIZE) / std::max<uint64_t>(tau_B, 1);
+
+    return CLANK_BACKUP_ARCH_TIME + snapshot_pages * HIBERNUS_PAGE_TIME;
+  }
+
+  uint64_t restore(stats_bundle *stats) override
+  {
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    // without a snapshot, the application starts over
+    thumbulator::cpu_reset();
+    if(!has_snapshot) {
+      thumbulator::cpu_set_pc(thumbulator::cpu_get_pc() + 0x4);
+
+      return 0;
+    }
+
+    // restore saved architectural and application state
+    thumbulator::cpu = architectural_state;
+    thumbulator::SYSTICK = systick;
+    thumbulator::CPU_IS_SLEEPING = sleeping;
+    thumbulator::EVENT_REGISTER = event_register;
+    thumbulator::systick_resume();
+    thumbulator::check_pending_exceptions();
+
+    auto word = snapshot.begin();
+    for(size_t i = 0; i < snapshot_pages; ++i) {
+      std::copy(word, word + HIBERNUS_PAGE_SIZE / 4,
+          thumbulator::RAM + pages[i] * HIBERNUS_PAGE_SIZE / 4);
+      word += HIBERNUS_PAGE_SIZE / 4;
+    }
+
+    auto const restore_energy = CLANK_RESTORE_ENERGY + snapshot_pages * HIBERNUS_PAGE_ENERGY;
+    stats->models.back().energy_for_restore = restore_energy;
+    battery.consume_energy(restore_energy);
+
+    return CLANK_BACKUP_ARCH_TIME + snapshot_pages * HIBERNUS_PAGE_TIME;
+  }
+
+  double estimate_progress(eh_model_parameters const &eh) const override
+  {
+    // the snapshot is taken right before the power fails, so no cycles are lost
+    return estimate_eh_progress(eh, dead_cycles::best_case, HIBERNUS_OMEGA_R, HIBERNUS_SIGMA_R,
+        HIBERNUS_A_R, HIBERNUS_OMEGA_B, HIBERNUS_SIGMA_B, HIBERNUS_A_B);
+  }
+
+private:
+  capacitor battery;
+  bool active = false;
+
+  uint64_t last_backup_cycle = 0u;
+
+  // the pages of RAM the application touched, in the order they were first touched
+  std::vector<bool> touched;
+  std::vector<uint32_t> pages;
+  bool scanned = false;
+
+  bool has_snapshot = false;
+  thumbulator::cpu_state architectural_state{};
+  thumbulator::system_tick systick{};
+  bool sleeping = false;
+  bool event_register = false;
+  // the contents of the first snapshot_pages pages
+  std::vector<uint32_t> snapshot;
+  size_t snapshot_pages = 0u;
+
+  void power_on()
+  {
+    active = true;
+
+    // memory is zero after a reset, so the pages filled by the loader are touched already
+    if(!scanned) {
+      for(uint32_t page = 0; page < touched.size(); ++page) {
+        auto const begin = thumbulator::RAM + page * HIBERNUS_PAGE_SIZE / 4;
+        auto const end = begin + HIBERNUS_PAGE_SIZE / 4;
+
+        if(std::any_of(begin, end, [](uint32_t word) { return word != 0; })) {
+          touch(page);
+        }
+      }
+
+      scanned = true;
+    }
+  }
+
+  double snapshot_energy() const
+  {
+    return CLANK_BACKUP_ARCH_ENERGY + pages.size() * HIBERNUS_PAGE_ENERGY;
+  }
+
+  /**
+   * The energy left when the snapshot must be taken, with room for the longest step to touch a
+   * new page.
+   */
+  double hibernate_threshold() const
+  {
+    return snapshot_energy() + HIBERNUS_PAGE_ENERGY
+           + CLANK_INSTRUCTION_ENERGY * HIBERNUS_LONGEST_STEP;
+  }
+
+  /**
+   * The energy to restore at, a fixed hysteresis above the voltage that leaves enough energy to
+   * restore and to take the next snapshot.
+   */
+  double restore_threshold() const
+  {
+    auto const restore_energy = CLANK_RESTORE_ENERGY + snapshot_pages * HIBERNUS_PAGE_ENERGY;
+    auto const voltage = calculate_voltage(
+        hibernate_threshold() + restore_energy, battery.capacitance());
+
+    return std::min(battery.maximum_energy_stored(),
+        calculate_energy(voltage + HIBERNUS_RESTORE_HYSTERESIS, battery.capacitance()));
+  }
+
+  void touch(uint32_t page)
+  {
+    if(!touched[page]) {
+      touched[page] = true;
+      pages.push_back(page);
+    }
+  }
+
+  uint32_t process_store(uint32_t address, uint32_t last_value, uint32_t value)
+  {
+    touch((address & RAM_ADDRESS_MASK) / HIBERNUS_PAGE_SIZE);
+
+    return value;
+  }
+};
+}
+
+#endif //EH_SIM_HIBERNUS_HPP
@@ -35,6 +35,11 @@ public:
   {
   }
 
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    return cycles;
+  }
+
   bool is_active(stats_bundle *stats) override
   {
     return true;
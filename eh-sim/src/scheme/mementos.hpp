@@ -0,0 +1,297 @@
+#ifndef EH_SIM_MEMENTOS_HPP
+#define EH_SIM_MEMENTOS_HPP
+
+#include "scheme/eh_scheme.hpp"
+#include "scheme/data_sheet.hpp"
+#include "scheme/eh_model.hpp"
+#include "capacitor.hpp"
+#include "stats.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/memory.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * Based on Mementos: System Support for Long-Running Computation on RFID-Scale Devices.
+ *
+ * Trigger points at the back-edges of loops and at task boundaries check the capacitor voltage,
+ * and checkpoint the registers, the live stack, and the globals to flash if it is below a
+ * threshold. Checkpoints requested by the application are always taken.
+ */
+class mementos : public eh_scheme {
+public:
+  /**
+   * Construct a default mementos configuration.
+   */
+  mementos() : mementos(MEMENTOS_THRESHOLD_VOLTAGE)
+  {
+  }
+
+  explicit mementos(double threshold_voltage)
+      : battery(MEMENTOS_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
+      , THRESHOLD_ENERGY(calculate_energy(threshold_voltage, MEMENTOS_CAPACITANCE))
+  {
+    thumbulator::ram_store_hook = [this](uint32_t address, uint32_t last_value,
+        uint32_t value) -> uint32_t { return this->process_store(address, last_value, value); };
+  }
+
+  capacitor &get_battery() override
+  {
+    return battery;
+  }
+
+  uint32_t clock_frequency() const override
+  {
+    return MEMENTOS_CPU_FREQUENCY;
+  }
+
+  bool saves_volatile_memory() const override
+  {
+    return true;
+  }
+
+  double min_energy_to_power_on(stats_bundle *stats) override
+  {
+    return battery.maximum_energy_stored();
+  }
+
+  void execute_instruction(stats_bundle *stats) override
+  {
+    execute_instructions(stats, 1);
+  }
+
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    auto const instruction_energy = MEMENTOS_INSTRUCTION_ENERGY * count;
+    battery.consume_energy(instruction_energy);
+    stats->models.back().energy_for_instructions += instruction_energy;
+
+    // the lowest stack pointer bounds the stack from the globals
+    auto const sp = thumbulator::cpu_get_gpr(13);
+    if(sp < lowest_sp) {
+      grow_stack(sp);
+    }
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // there are no trigger points while asleep
+    cycles = cycles_to_sleep(
+        battery.energy_stored(), MEMENTOS_INSTRUCTION_ENERGY, MEMENTOS_SLEEP_ENERGY, cycles);
+
+    auto const sleep_energy = MEMENTOS_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
+  void back_edge(stats_bundle *stats, uint32_t address) override
+  {
+    trigger(false);
+  }
+
+  void hypercall(
+      stats_bundle *stats, thumbulator::hypercall call, uint32_t r0, uint32_t r1) override
+  {
+    if(call == thumbulator::hypercall::task_boundary) {
+      trigger(false);
+    } else if(call == thumbulator::hypercall::checkpoint) {
+      trigger(true);
+    }
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    // the trigger points in the run must not have checkpointed
+    auto const energy = instructions * MEMENTOS_INSTRUCTION_ENERGY;
+
+    return !checkpoint_requested && battery.energy_stored() >= energy + THRESHOLD_ENERGY;
+  }
+
+  bool is_active(stats_bundle *stats) override
+  {
+    if(battery.energy_stored() >= battery.maximum_energy_stored()) {
+      active = true;
+    } else if(battery.energy_stored() < MEMENTOS_INSTRUCTION_ENERGY) {
+      active = false;
+      checkpoint_requested = false;
+    }
+
+    return active;
+  }
+
+  bool will_backup(stats_bundle *stats) const override
+  {
+    return checkpoint_requested;
+  }
+
+  uint64_t backup(stats_bundle *stats) override
+  {
+    auto &active_stats = stats->models.back();
+    active_stats.num_backups++;
+
+    auto const tau_B = stats->cpu.cycle_count - last_backup_cycle;
+    active_stats.time_between_backups += tau_B;
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    auto const backup_energy = checkpoint_energy();
+    active_stats.energy_for_backups += backup_energy;
+    battery.consume_energy(backup_energy);
+
+    // save architectural state
+    architectural_state = thumbulator::cpu;
+    has_checkpoint = true;
+    checkpoint_requested = false;
+
+    // save application state: the live stack, and the globals written outside of the stack
+    checkpoint.clear();
+    for(auto address = checkpoint_sp; address < stack_top(); address += 4) {
+      save_word(address);
+    }
+    for(auto const address : written) {
+      if(!in_stack(address)) {
+        save_word(address);
+      }
+    }
+
+    active_stats.bytes_application += static_cast<double>(checkpoint.size() * 4) / tau_B;
+
+    // writing flash is slow, so even the registers take longer than a 1 ms sample of a trace
+    auto const words = MEMENTOS_ARCH_WORDS + checkpoint.size();
+    return words * MEMENTOS_MOVES_PER_WORD * MEMENTOS_FLASH_WRITE_TIME;
+  }
+
+  uint64_t restore(stats_bundle *stats) override
+  {
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    // without a checkpoint, the application starts over
+    thumbulator::cpu_reset();
+    if(!has_checkpoint) {
+      thumbulator::cpu_set_pc(thumbulator::cpu_get_pc() + 0x4);
+
+      return 0;
+    }
+
+    // restore saved architectural and application state
+    thumbulator::cpu = architectural_state;
+    for(auto const &word : checkpoint) {
+      thumbulator::RAM[(word.first & RAM_ADDRESS_MASK) >> 2] = word.second;
+    }
+
+    auto const restore_energy = MEMENTOS_MOVES_PER_WORD
+                                * (MEMENTOS_ARCH_WORDS * MEMENTOS_REG_FLASH
+                                      + checkpoint.size() * MEMENTOS_MEM_FLASH);
+    stats->models.back().energy_for_restore = restore_energy;
+    battery.consume_energy(restore_energy);
+
+    auto const words = MEMENTOS_ARCH_WORDS + checkpoint.size();
+    return words * MEMENTOS_MOVES_PER_WORD * MEMENTOS_FLASH_READ_TIME;
+  }
+
+  double estimate_progress(eh_model_parameters const &eh) const override
+  {
+    return estimate_eh_progress(eh, dead_cycles::average_case, MEMENTOS_OMEGA_R, MEMENTOS_SIGMA_R,
+        MEMENTOS_A_R, MEMENTOS_OMEGA_B, MEMENTOS_SIGMA_B, MEMENTOS_A_B);
+  }
+
+private:
+  capacitor battery;
+  bool active = false;
+
+  double const THRESHOLD_ENERGY;
+
+  uint64_t last_backup_cycle = 0u;
+  uint32_t lowest_sp = UINT32_MAX;
+
+  bool checkpoint_requested = false;
+  bool has_checkpoint = false;
+
+  thumbulator::cpu_state architectural_state{};
+
+  // the words the application has written, and how many of them are globals outside of the stack
+  std::unordered_set<uint32_t> written;
+  uint64_t global_words = 0u;
+
+  // the stack pointer and the size of the requested checkpoint, and the saved words with values
+  uint32_t checkpoint_sp = 0u;
+  uint64_t checkpoint_words = 0u;
+  std::vector<std::pair<uint32_t, uint32_t>> checkpoint;
+
+  double checkpoint_energy() const
+  {
+    return MEMENTOS_MOVES_PER_WORD
+           * (MEMENTOS_ARCH_WORDS * MEMENTOS_FLASH_REG + checkpoint_words * MEMENTOS_FLASH_MEM);
+  }
+
+  /**
+   * The initial stack pointer in the vector table.
+   */
+  static uint32_t stack_top()
+  {
+    return thumbulator::FLASH_MEMORY[0] & ~0x3u;
+  }
+
+  bool in_stack(uint32_t address) const
+  {
+    return address >= lowest_sp && address < stack_top();
+  }
+
+  /**
+   * Move the bottom of the stack down, which turns the globals written there into stack.
+   */
+  void grow_stack(uint32_t sp)
+  {
+    auto const top = std::min(lowest_sp, stack_top());
+    for(auto address = sp & ~0x3u; address < top; address += 4) {
+      if(written.count(address) != 0) {
+        global_words--;
+      }
+    }
+
+    lowest_sp = sp & ~0x3u;
+  }
+
+  void save_word(uint32_t address)
+  {
+    checkpoint.emplace_back(address, thumbulator::RAM[(address & RAM_ADDRESS_MASK) >> 2]);
+  }
+
+  /**
+   * A trigger point, which checkpoints if the voltage is low or the application asked for it.
+   */
+  void trigger(bool requested)
+  {
+    if(!requested && battery.energy_stored() >= THRESHOLD_ENERGY) {
+      return;
+    }
+
+    // the live stack, from the stack pointer to the top, and the globals
+    checkpoint_sp = thumbulator::cpu_get_gpr(13) & ~0x3u;
+    checkpoint_words = (stack_top() - std::min(checkpoint_sp, stack_top())) / 4 + global_words;
+
+    // a checkpoint without enough energy to finish is not attempted
+    checkpoint_requested = battery.energy_stored() >= checkpoint_energy();
+  }
+
+  uint32_t process_store(uint32_t address, uint32_t last_value, uint32_t value)
+  {
+    auto const word = address & ~0x3u;
+    if(written.insert(word).second && !in_stack(word)) {
+      global_words++;
+    }
+
+    return value;
+  }
+};
+}
+
+#endif //EH_SIM_MEMENTOS_HPP
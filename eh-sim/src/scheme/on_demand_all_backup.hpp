@@ -36,6 +36,20 @@ public:
     stats->models.back().energy_for_instructions += NVP_INSTRUCTION_ENERGY;
   }
 
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // sleep until the energy warning
+    auto const energy_warning = NVP_ODAB_BACKUP_ENERGY + NVP_INSTRUCTION_ENERGY;
+    cycles = cycles_to_sleep(battery.energy_stored(), energy_warning, NVP_SLEEP_ENERGY, cycles);
+
+    auto const sleep_energy = NVP_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
   bool is_active(stats_bundle *stats) override
   {
     if(battery.energy_stored() >= battery.maximum_energy_stored()) {
@@ -0,0 +1,168 @@
+#ifndef EH_SIM_ORACLE_HPP
+#define EH_SIM_ORACLE_HPP
+
+#include "scheme/eh_scheme.hpp"
+#include "scheme/data_sheet.hpp"
+#include "scheme/eh_model.hpp"
+#include "capacitor.hpp"
+#include "stats.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/exception.hpp>
+
+namespace ehsim {
+
+/**
+ * An oracle that knows when the power fails.
+ *
+ * It takes a single backup of the architectural state right before each power failure, and pays
+ * nothing to find out when that is. It runs on Clank's hardware, which keeps memory in
+ * non-volatile storage, and bounds the forward progress of clank and parametric.
+ */
+class oracle : public eh_scheme {
+public:
+  oracle() : battery(NVP_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
+  {
+  }
+
+  capacitor &get_battery() override
+  {
+    return battery;
+  }
+
+  uint32_t clock_frequency() const override
+  {
+    return CORTEX_M0PLUS_FREQUENCY;
+  }
+
+  double min_energy_to_power_on(stats_bundle *stats) override
+  {
+    return battery.maximum_energy_stored();
+  }
+
+  void execute_instruction(stats_bundle *stats) override
+  {
+    auto const elapsed_cycles = stats->cpu.cycle_count - last_tick;
+    last_tick = stats->cpu.cycle_count;
+
+    auto const instruction_energy = CLANK_INSTRUCTION_ENERGY * elapsed_cycles;
+    battery.consume_energy(instruction_energy);
+    stats->models.back().energy_for_instructions += instruction_energy;
+  }
+
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    // the energy of every cycle since the last instruction is charged at once
+    if(count > 0) {
+      execute_instruction(stats);
+    }
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    cycles = cycles_to_sleep(battery.energy_stored(), failure_energy(), CLANK_SLEEP_ENERGY, cycles);
+    last_tick += cycles;
+
+    auto const sleep_energy = CLANK_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    auto const energy = CLANK_INSTRUCTION_ENERGY * cycles;
+
+    return battery.energy_stored() >= energy + failure_energy();
+  }
+
+  bool is_active(stats_bundle *stats) override
+  {
+    if(battery.energy_stored() >= battery.maximum_energy_stored()) {
+      active = true;
+    }
+
+    return active;
+  }
+
+  bool will_backup(stats_bundle *stats) const override
+  {
+    // the next step could be the last one
+    return battery.energy_stored() < failure_energy();
+  }
+
+  uint64_t backup(stats_bundle *stats) override
+  {
+    auto &active_stats = stats->models.back();
+    active_stats.num_backups++;
+
+    active_stats.time_between_backups += stats->cpu.cycle_count - last_backup_cycle;
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    // save architectural state, including the peripherals
+    thumbulator::systick_update();
+    architectural_state = thumbulator::cpu;
+    systick = thumbulator::SYSTICK;
+    sleeping = thumbulator::CPU_IS_SLEEPING;
+    event_register = thumbulator::EVENT_REGISTER;
+
+    active_stats.energy_for_backups += CLANK_BACKUP_ARCH_ENERGY;
+    battery.consume_energy(CLANK_BACKUP_ARCH_ENERGY);
+
+    // the power fails right after the backup
+    active = false;
+
+    return CLANK_BACKUP_ARCH_TIME;
+  }
+
+  uint64_t restore(stats_bundle *stats) override
+  {
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    // restore saved architectural state
+    thumbulator::cpu_reset();
+    thumbulator::cpu = architectural_state;
+    thumbulator::SYSTICK = systick;
+    thumbulator::CPU_IS_SLEEPING = sleeping;
+    thumbulator::EVENT_REGISTER = event_register;
+    thumbulator::systick_resume();
+    thumbulator::check_pending_exceptions();
+
+    stats->models.back().energy_for_restore = CLANK_RESTORE_ENERGY;
+    battery.consume_energy(CLANK_RESTORE_ENERGY);
+
+    return CLANK_BACKUP_ARCH_TIME;
+  }
+
+  double estimate_progress(eh_model_parameters const &eh) const override
+  {
+    // no cycles are lost to a power failure
+    return estimate_eh_progress(eh, dead_cycles::best_case, CLANK_OMEGA_R, CLANK_SIGMA_R,
+        CLANK_A_R, CLANK_OMEGA_B, CLANK_SIGMA_B, CLANK_A_B);
+  }
+
+private:
+  capacitor battery;
+  bool active = false;
+
+  uint64_t last_backup_cycle = 0u;
+  uint64_t last_tick = 0u;
+
+  thumbulator::cpu_state architectural_state{};
+  thumbulator::system_tick systick{};
+  bool sleeping = false;
+  bool event_register = false;
+
+  /**
+   * The energy below which the longest step could leave too little for the backup.
+   */
+  static double failure_energy()
+  {
+    return CLANK_BACKUP_ARCH_ENERGY + CLANK_INSTRUCTION_ENERGY * ORACLE_LONGEST_STEP;
+  }
+};
+}
+
+#endif //EH_SIM_ORACLE_HPP
@@ -3,21 +3,31 @@
 
 #include "scheme/eh_scheme.hpp"
 #include "scheme/data_sheet.hpp"
+#include "scheme/dvfs.hpp"
+#include "scheme/eh_model.hpp"
 #include "capacitor.hpp"
 #include "stats.hpp"
 
 #include <thumbulator/memory.hpp>
 
+#include <limits>
 #include <unordered_map>
 
 namespace ehsim {
 
 class parametric : public eh_scheme {
 public:
-  explicit parametric(int backup_period)
+  /**
+   * @param backup_period The backup period in cycles, or the initial one if it is adaptive.
+   * @param adaptive Re-tune the backup period at the start of every active period.
+   * @param dvfs Scale the voltage and frequency with the harvested power.
+   */
+  explicit parametric(int backup_period, bool adaptive = false, bool dvfs = false)
       : battery(MEMENTOS_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
-      , BACKUP_PERIOD(backup_period)
-      , countdown_to_backup(BACKUP_PERIOD)
+      , governor(dvfs)
+      , ADAPTIVE(adaptive)
+      , backup_period(backup_period)
+      , countdown_to_backup(backup_period)
   {
     thumbulator::ram_load_hook = [this](
         uint32_t address, uint32_t data) -> uint32_t { return this->process_read(address, data); };
@@ -33,7 +43,7 @@ public:
 
   uint32_t clock_frequency() const override
   {
-    return MEMENTOS_CPU_FREQUENCY;
+    return governor.frequency();
   }
 
   double min_energy_to_power_on(stats_bundle *stats) override
@@ -43,13 +53,65 @@ public:
 
   void execute_instruction(stats_bundle *stats) override
   {
-    battery.consume_energy(CLANK_INSTRUCTION_ENERGY);
-    stats->models.back().energy_for_instructions += CLANK_INSTRUCTION_ENERGY;
+    execute_instructions(stats, 1);
+  }
+
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    auto const instruction_energy = governor.scale(CLANK_INSTRUCTION_ENERGY) * count;
+    battery.consume_energy(instruction_energy);
+    stats->models.back().energy_for_instructions += instruction_energy;
 
     countdown_to_backup -= stats->cpu.cycle_count - last_tick;
     last_tick = stats->cpu.cycle_count;
   }
 
+  void hypercall(
+      stats_bundle *stats, thumbulator::hypercall call, uint32_t r0, uint32_t r1) override
+  {
+    // a requested checkpoint ends the backup period
+    if(call == thumbulator::hypercall::checkpoint) {
+      countdown_to_backup = 0;
+    }
+  }
+
+  void harvested_power(stats_bundle *stats, double power) override
+  {
+    governor.select(power, CLANK_INSTRUCTION_ENERGY);
+  }
+
+  double memory_access_energy(double energy) const override
+  {
+    return governor.scale(energy);
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    auto const energy = instructions * governor.scale(CLANK_INSTRUCTION_ENERGY);
+
+    return countdown_to_backup > static_cast<int64_t>(cycles)
+           && battery.energy_stored() >= energy + calculate_backup_energy();
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // the countdown keeps counting while the CPU sleeps
+    cycles = std::min<uint64_t>(cycles, std::max(countdown_to_backup, 1));
+    auto const energy_per_cycle = governor.scale(CLANK_SLEEP_ENERGY);
+    cycles = cycles_to_sleep(
+        battery.energy_stored(), calculate_backup_energy(), energy_per_cycle, cycles);
+
+    countdown_to_backup -= static_cast<int>(cycles);
+    last_tick += cycles;
+
+    auto const sleep_energy = energy_per_cycle * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
   bool is_active(stats_bundle *stats) override
   {
     if(battery.energy_stored() == battery.maximum_energy_stored()) {
@@ -89,7 +151,7 @@ public:
     battery.consume_energy(backup_energy);
 
     // reset countdown
-    countdown_to_backup = BACKUP_PERIOD;
+    countdown_to_backup = backup_period;
     // save architectural state
     architectural_state = thumbulator::cpu;
     // save application state
@@ -102,8 +164,12 @@ public:
 
   uint64_t restore(stats_bundle *stats) override
   {
+    if(ADAPTIVE) {
+      retune(stats);
+    }
+
     // reset countdown
-    countdown_to_backup = BACKUP_PERIOD;
+    countdown_to_backup = backup_period;
     last_backup_cycle = stats->cpu.cycle_count;
 
     // restore saved architectural state
@@ -124,12 +190,14 @@ public:
 
 private:
   capacitor battery;
+  dvfs_governor governor;
   bool active = false;
 
   uint64_t last_backup_cycle = 0u;
   uint64_t last_tick = 0u;
 
-  int const BACKUP_PERIOD;
+  bool const ADAPTIVE;
+  int backup_period;
   int countdown_to_backup;
 
   thumbulator::cpu_state architectural_state{};
@@ -146,6 +214,34 @@ private:
     stores.clear();
   }
 
+  /**
+   * Pick the backup period that the EH model predicts the most progress for in the last active
+   * period.
+   */
+  void retune(stats_bundle const *stats)
+  {
+    if(stats->models.size() < 2) {
+      return;
+    }
+
+    // the bytes backed up per cycle are unknown without a backup
+    auto const &last_period = stats->models[stats->models.size() - 2];
+    if(last_period.num_backups == 0) {
+      return;
+    }
+
+    eh_model_parameters const observed(last_period);
+    auto best_progress = -std::numeric_limits<double>::infinity();
+    for(auto tau_B = PARAMETRIC_MIN_TAU_B; tau_B <= PARAMETRIC_MAX_TAU_B;
+        tau_B += PARAMETRIC_TAU_B_STEP) {
+      auto const progress = estimate_progress(eh_model_parameters(observed, tau_B));
+      if(progress > best_progress) {
+        best_progress = progress;
+        backup_period = tau_B;
+      }
+    }
+  }
+
   double calculate_backup_energy() const
   {
     return CLANK_BACKUP_ARCH_ENERGY + (stores.size() * 4 * CORTEX_M0PLUS_ENERGY_FLASH);
@@ -0,0 +1,265 @@
+#ifndef EH_SIM_UNDO_LOG_HPP
+#define EH_SIM_UNDO_LOG_HPP
+
+#include "scheme/eh_scheme.hpp"
+#include "scheme/data_sheet.hpp"
+#include "scheme/eh_model.hpp"
+#include "capacitor.hpp"
+#include "stats.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/exception.hpp>
+#include <thumbulator/memory.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * Periodic backups of the architectural state, with an undo log for the application state.
+ *
+ * Stores write memory in place, and the first store to a word since the last backup appends the
+ * word's old value to a bounded log in non-volatile memory. A backup commits the log, and a power
+ * failure rolls memory back to the last commit. Loads read memory directly, unlike parametric's
+ * redo buffer.
+ */
+class undo_log : public eh_scheme {
+public:
+  /**
+   * @param backup_period The backup period in cycles.
+   * @param log_capacity The number of entries in the log, which is committed before it fills.
+   * @param entry_energy The energy to append an entry to the log.
+   * @param commit_energy The energy to commit the log, on top of backing up the registers.
+   */
+  undo_log(int backup_period,
+      uint64_t log_capacity = UNDO_LOG_CAPACITY,
+      double entry_energy = UNDO_LOG_ENTRY_ENERGY,
+      double commit_energy = UNDO_LOG_COMMIT_ENERGY)
+      : battery(MEMENTOS_CAPACITANCE, MEMENTOS_MAX_CAPACITOR_VOLTAGE, MEMENTOS_MAX_CURRENT)
+      , BACKUP_PERIOD(backup_period)
+      , LOG_CAPACITY(std::max(log_capacity, UNDO_LOG_STEP_STORES))
+      , ENTRY_ENERGY(entry_energy)
+      , COMMIT_ENERGY(commit_energy)
+      , countdown_to_backup(backup_period)
+  {
+    log.reserve(LOG_CAPACITY);
+
+    thumbulator::ram_store_hook = [this](uint32_t address, uint32_t last_value,
+        uint32_t value) -> uint32_t { return this->process_store(address, last_value, value); };
+  }
+
+  capacitor &get_battery() override
+  {
+    return battery;
+  }
+
+  uint32_t clock_frequency() const override
+  {
+    return CORTEX_M0PLUS_FREQUENCY;
+  }
+
+  double min_energy_to_power_on(stats_bundle *stats) override
+  {
+    return battery.maximum_energy_stored();
+  }
+
+  void execute_instruction(stats_bundle *stats) override
+  {
+    execute_instructions(stats, 1);
+  }
+
+  void execute_instructions(stats_bundle *stats, uint64_t count) override
+  {
+    auto const instruction_energy = CLANK_INSTRUCTION_ENERGY * count;
+    battery.consume_energy(instruction_energy);
+    stats->models.back().energy_for_instructions += instruction_energy;
+
+    // the battery paid for the entries as they were logged
+    stats->models.back().energy_for_backups += unaccounted_log_energy;
+    unaccounted_log_energy = 0.0;
+
+    countdown_to_backup -= stats->cpu.cycle_count - last_tick;
+    last_tick = stats->cpu.cycle_count;
+  }
+
+  void hypercall(
+      stats_bundle *stats, thumbulator::hypercall call, uint32_t r0, uint32_t r1) override
+  {
+    // a requested checkpoint ends the backup period
+    if(call == thumbulator::hypercall::checkpoint) {
+      countdown_to_backup = 0;
+    }
+  }
+
+  bool can_fast_forward(stats_bundle *stats, uint64_t instructions, uint64_t cycles) override
+  {
+    // each instruction of the run could log a word
+    auto const energy = instructions * (CLANK_INSTRUCTION_ENERGY + ENTRY_ENERGY);
+
+    return countdown_to_backup > static_cast<int64_t>(cycles)
+           && log.size() + instructions + UNDO_LOG_STEP_STORES <= LOG_CAPACITY
+           && battery.energy_stored() >= energy + calculate_backup_energy();
+  }
+
+  uint64_t sleep(stats_bundle *stats, uint64_t cycles) override
+  {
+    // the countdown keeps counting while the CPU sleeps
+    cycles = std::min<uint64_t>(cycles, std::max(countdown_to_backup, 1));
+    cycles = cycles_to_sleep(
+        battery.energy_stored(), calculate_backup_energy(), CLANK_SLEEP_ENERGY, cycles);
+
+    countdown_to_backup -= static_cast<int>(cycles);
+    last_tick += cycles;
+
+    auto const sleep_energy = CLANK_SLEEP_ENERGY * cycles;
+    battery.consume_energy(sleep_energy);
+    stats->models.back().energy_for_instructions += sleep_energy;
+    stats->models.back().energy_for_sleep += sleep_energy;
+
+    return cycles;
+  }
+
+  bool is_active(stats_bundle *stats) override
+  {
+    if(battery.energy_stored() == battery.maximum_energy_stored()) {
+      active = true;
+    } else if(battery.energy_stored() < calculate_backup_energy()) {
+      active = false;
+    } else if(countdown_to_backup < 0) {
+      // the countdown ran out without the energy to back up
+      active = false;
+    }
+
+    return active;
+  }
+
+  bool will_backup(stats_bundle *stats) const override
+  {
+    if(battery.energy_stored() < calculate_backup_energy()) {
+      return false;
+    }
+
+    // the next step must not overflow the log
+    return countdown_to_backup <= 0 || log.size() + UNDO_LOG_STEP_STORES > LOG_CAPACITY;
+  }
+
+  uint64_t backup(stats_bundle *stats) override
+  {
+    auto &active_stats = stats->models.back();
+    active_stats.num_backups++;
+
+    auto const tau_B = stats->cpu.cycle_count - last_backup_cycle;
+    active_stats.time_between_backups += tau_B;
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    auto const backup_energy = calculate_backup_energy();
+    active_stats.energy_for_backups += backup_energy;
+    battery.consume_energy(backup_energy);
+
+    // reset countdown
+    countdown_to_backup = BACKUP_PERIOD;
+
+    // save architectural state, including the peripherals
+    thumbulator::systick_update();
+    architectural_state = thumbulator::cpu;
+    systick = thumbulator::SYSTICK;
+    sleeping = thumbulator::CPU_IS_SLEEPING;
+    event_register = thumbulator::EVENT_REGISTER;
+    has_backup = true;
+
+    // memory is up to date, so committing only empties the log
+    active_stats.bytes_application += static_cast<double>(log.size() * 4) / tau_B;
+    log.clear();
+    logged.clear();
+
+    return CLANK_BACKUP_ARCH_TIME + UNDO_LOG_COMMIT_TIME;
+  }
+
+  uint64_t restore(stats_bundle *stats) override
+  {
+    // reset countdown
+    countdown_to_backup = BACKUP_PERIOD;
+    last_backup_cycle = stats->cpu.cycle_count;
+
+    // roll back the stores since the last backup, newest first
+    auto const entries = log.size();
+    for(auto entry = log.rbegin(); entry != log.rend(); ++entry) {
+      thumbulator::RAM[(entry->first & RAM_ADDRESS_MASK) >> 2] = entry->second;
+    }
+    log.clear();
+    logged.clear();
+
+    auto const restore_energy = CLANK_RESTORE_ENERGY + entries * ENTRY_ENERGY;
+    stats->models.back().energy_for_restore = restore_energy;
+    battery.consume_energy(restore_energy);
+
+    // without a backup, the application starts over
+    thumbulator::cpu_reset();
+    if(!has_backup) {
+      thumbulator::cpu_set_pc(thumbulator::cpu_get_pc() + 0x4);
+    } else {
+      thumbulator::cpu = architectural_state;
+      thumbulator::SYSTICK = systick;
+      thumbulator::CPU_IS_SLEEPING = sleeping;
+      thumbulator::EVENT_REGISTER = event_register;
+      thumbulator::systick_resume();
+      thumbulator::check_pending_exceptions();
+    }
+
+    return CLANK_BACKUP_ARCH_TIME + entries * UNDO_LOG_ENTRY_TIME;
+  }
+
+  double estimate_progress(eh_model_parameters const &eh) const override
+  {
+    return estimate_eh_progress(eh, dead_cycles::average_case, UNDO_LOG_OMEGA_R, UNDO_LOG_SIGMA_R,
+        UNDO_LOG_A_R, UNDO_LOG_OMEGA_B, UNDO_LOG_SIGMA_B, UNDO_LOG_A_B);
+  }
+
+private:
+  capacitor battery;
+  bool active = false;
+
+  int const BACKUP_PERIOD;
+  uint64_t const LOG_CAPACITY;
+  double const ENTRY_ENERGY;
+  double const COMMIT_ENERGY;
+
+  uint64_t last_backup_cycle = 0u;
+  uint64_t last_tick = 0u;
+  int countdown_to_backup;
+
+  bool has_backup = false;
+  thumbulator::cpu_state architectural_state{};
+  thumbulator::system_tick systick{};
+  bool sleeping = false;
+  bool event_register = false;
+
+  // the addresses and old values of the words stored to since the last backup
+  std::vector<std::pair<uint32_t, uint32_t>> log;
+  std::unordered_set<uint32_t> logged;
+  double unaccounted_log_energy = 0.0;
+
+  double calculate_backup_energy() const
+  {
+    return CLANK_BACKUP_ARCH_ENERGY + COMMIT_ENERGY;
+  }
+
+  uint32_t process_store(uint32_t address, uint32_t last_value, uint32_t value)
+  {
+    // only the value at the last backup is needed to roll a word back
+    if(logged.insert(address).second) {
+      log.emplace_back(address, last_value);
+
+      battery.consume_energy(ENTRY_ENERGY);
+      unaccounted_log_energy += ENTRY_ENERGY;
+    }
+
+    return value;
+  }
+};
+}
+
+#endif //EH_SIM_UNDO_LOG_HPP
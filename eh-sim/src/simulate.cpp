@@ -1,38 +1,40 @@
 #include "simulate.hpp"
 
 #include <thumbulator/cpu.hpp>
+#include <thumbulator/event.hpp>
+#include <thumbulator/fault.hpp>
+#include <thumbulator/hle.hpp>
+#include <thumbulator/hypercall.hpp>
+#include <thumbulator/loop.hpp>
 #include <thumbulator/memory.hpp>
+#include <thumbulator/program.hpp>
 
 #include "scheme/eh_scheme.hpp"
+#include "call_graph.hpp"
 #include "capacitor.hpp"
+#include "profile.hpp"
+#include "snapshot.hpp"
 #include "stats.hpp"
-#include "voltage_trace.hpp"
+#include "power_source.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <utility>
 
 namespace ehsim {
 
-void load_program(char const *file_name)
-{
-  std::FILE *fd = std::fopen(file_name, "r");
-  if(fd == nullptr) {
-    throw std::runtime_error("Could not open binary file.\n");
-  }
-
-  std::fread(&thumbulator::FLASH_MEMORY, sizeof(uint32_t),
-      sizeof(thumbulator::FLASH_MEMORY) / sizeof(uint32_t), fd);
-  std::fclose(fd);
-}
-
 void initialize_system(char const *binary_file)
 {
   // Reset memory, then load program to memory
   std::memset(thumbulator::RAM, 0, sizeof(thumbulator::RAM));
   std::memset(thumbulator::FLASH_MEMORY, 0, sizeof(thumbulator::FLASH_MEMORY));
-  load_program(binary_file);
+  thumbulator::load_program(binary_file);
 
   // Initialize CPU state
+  thumbulator::EXIT_INSTRUCTION_ENCOUNTERED = false;
   thumbulator::cpu_reset();
 
   // PC seen is PC + 4
@@ -47,10 +49,11 @@ void initialize_system(char const *binary_file)
 uint32_t step_cpu()
 {
   thumbulator::BRANCH_WAS_TAKEN = false;
+  thumbulator::NATIVE_INSTRUCTIONS = 0;
 
   if((thumbulator::cpu_get_pc() & 0x1) == 0) {
-    printf("Oh no! Current PC: 0x%08X\n", thumbulator::cpu.gpr[15]);
-    throw std::runtime_error("PC moved out of thumb mode.");
+    auto const pc = thumbulator::cpu_get_pc();
+    throw thumbulator::fault(thumbulator::fault_type::invalid_pc, pc - 0x4, pc, 0);
   }
 
   // fetch
@@ -71,17 +74,176 @@ uint32_t step_cpu()
   return instruction_ticks;
 }
 
-std::chrono::nanoseconds get_time(uint64_t const cycle_count, uint32_t const frequency)
+/**
+ * The cycles until the next event, which may wake the sleeping CPU up.
+ */
+uint64_t cycles_until_wake_up()
 {
-  double const CPU_PERIOD = 1.0 / frequency;
-  auto const time = static_cast<uint64_t>(CPU_PERIOD * cycle_count * 1e9);
+  // no instruction executes while asleep, so nothing else can schedule an event
+  if(thumbulator::NEXT_EVENT_CYCLE == UINT64_MAX) {
+    // PC seen is PC + 4, after the wfi or wfe
+    auto const pc = thumbulator::cpu_get_pc();
+    throw thumbulator::fault(thumbulator::fault_type::deadlock, (pc - 0x6) & ~0x1u, pc, 0);
+  }
 
-  return std::chrono::nanoseconds(time);
+  return std::max<uint64_t>(1, thumbulator::NEXT_EVENT_CYCLE - thumbulator::CYCLE_COUNT);
+}
+
+/**
+ * Sleep for a number of cycles, without stepping instructions.
+ *
+ * An exception that becomes ready in the meantime wakes the CPU up and is taken.
+ *
+ * @return Number of cycles to take an exception, zero if none was taken.
+ */
+uint32_t sleep_cpu(uint64_t cycles)
+{
+  // the exception returns to the next instruction, as if a branch had moved the PC there
+  thumbulator::BRANCH_WAS_TAKEN = true;
+  thumbulator::cpu_set_pc(thumbulator::cpu_get_pc() - 0x4);
+
+  auto const exception_ticks = thumbulator::advance_cycles(cycles);
+
+  // PC seen is PC + 4
+  thumbulator::cpu_set_pc(thumbulator::cpu_get_pc() + 0x4);
+
+  return exception_ticks;
+}
+
+/**
+ * The number of instructions the last step executed.
+ *
+ * More than one if the step executed a runtime helper natively.
+ */
+uint32_t instructions_stepped()
+{
+  return std::max<uint32_t>(1, thumbulator::NATIVE_INSTRUCTIONS);
+}
+
+/**
+ * The address of the branch the last step took backwards, or 0 if it did not.
+ *
+ * @param pc_before The PC seen before the step.
+ */
+uint32_t backward_branch(uint32_t pc_before)
+{
+  if(thumbulator::BRANCH_WAS_TAKEN && thumbulator::cpu_get_pc() < pc_before) {
+    return (pc_before - 0x4) & ~0x1u;
+  }
+
+  return 0;
+}
+
+/**
+ * Plan the iterations of a loop that execute before the next backup and power failure.
+ */
+thumbulator::loop_run fit_loop(thumbulator::loop_accelerator &loops,
+    uint32_t branch,
+    eh_scheme *scheme,
+    stats_bundle *stats)
+{
+  auto run = loops.plan(branch);
+
+  // halve the run until the scheme can execute it at once
+  while(run.iterations > 0
+        && !scheme->can_fast_forward(stats, run.instructions(), run.cycles())) {
+    run.iterations /= 2;
+  }
+
+  return run;
+}
+
+/**
+ * Check if the next instruction to execute is at the execution point.
+ */
+bool reached(execution_point const &point, cpu_stats const &stats)
+{
+  if(point.at_pc) {
+    // PC seen is PC + 4, and the lowest bit marks thumb mode
+    return ((thumbulator::cpu_get_pc() - 0x4) & ~0x1u) == (point.pc & ~0x1u);
+  }
+
+  return stats.instruction_count >= point.instruction_count;
+}
+
+cpu_stats fast_forward(char const *binary_file,
+    execution_point const &until,
+    char const *snapshot_file)
+{
+  initialize_system(binary_file);
+
+  // the warm-up runs without a scheme observing memory accesses
+  decltype(thumbulator::ram_load_hook) load_hook = nullptr;
+  decltype(thumbulator::ram_store_hook) store_hook = nullptr;
+  decltype(thumbulator::native_helper_hook) helper_hook = nullptr;
+  decltype(thumbulator::hypercall_hook) hypercall_hook = nullptr;
+  std::swap(load_hook, thumbulator::ram_load_hook);
+  std::swap(store_hook, thumbulator::ram_store_hook);
+  std::swap(helper_hook, thumbulator::native_helper_hook);
+  std::swap(hypercall_hook, thumbulator::hypercall_hook);
+
+  thumbulator::loop_accelerator loops;
+  uint32_t loop_branch = 0;
+
+  cpu_stats stats{};
+  while(!thumbulator::EXIT_INSTRUCTION_ENCOUNTERED && !reached(until, stats)) {
+    if(loop_branch != 0) {
+      auto run = loops.plan(loop_branch);
+
+      // stop at the execution point, which may be inside the loop
+      auto const start = (thumbulator::cpu_get_pc() - 0x4) & ~0x1u;
+      if(until.at_pc && (until.pc & ~0x1u) >= start && (until.pc & ~0x1u) <= loop_branch) {
+        run.iterations = 0;
+      } else if(!until.at_pc) {
+        auto const remaining = until.instruction_count - stats.instruction_count - 1;
+        run.iterations = std::min(run.iterations, remaining / run.instructions_per_iteration);
+      }
+
+      loop_branch = 0;
+      if(run.iterations > 0) {
+        loops.execute(run);
+        stats.cycle_count += run.cycles();
+        stats.instruction_count += run.instructions();
+        continue;
+      }
+    }
+
+    auto const pc_before = thumbulator::cpu_get_pc();
+    stats.cycle_count += step_cpu();
+    stats.instruction_count += instructions_stepped();
+
+    if(thumbulator::ACCELERATE_LOOPS) {
+      loop_branch = backward_branch(pc_before);
+    }
+
+    // skip to the events that wake the CPU up
+    while(thumbulator::CPU_IS_SLEEPING) {
+      auto const cycles = cycles_until_wake_up();
+      stats.cycle_count += cycles + sleep_cpu(cycles);
+      loop_branch = 0;
+    }
+  }
+
+  std::swap(load_hook, thumbulator::ram_load_hook);
+  std::swap(store_hook, thumbulator::ram_store_hook);
+  std::swap(helper_hook, thumbulator::native_helper_hook);
+  std::swap(hypercall_hook, thumbulator::hypercall_hook);
+
+  if(thumbulator::EXIT_INSTRUCTION_ENCOUNTERED) {
+    throw std::runtime_error("Application exited before reaching the snapshot point.");
+  }
+
+  save_snapshot(snapshot_file, stats.instruction_count, stats.cycle_count);
+
+  return stats;
 }
 
-std::chrono::milliseconds to_milliseconds(std::chrono::nanoseconds const &time)
+std::chrono::nanoseconds get_time(uint64_t const cycle_count, uint32_t const frequency)
 {
-  return std::chrono::duration_cast<std::chrono::milliseconds>(time);
+  // rounded, since truncating loses a nanosecond whenever the period is not exact in binary
+  auto const time = static_cast<uint64_t>(std::llround(cycle_count * 1e9 / frequency));
+
+  return std::chrono::nanoseconds(time);
 }
 
 uint64_t time_to_cycles(std::chrono::nanoseconds elapsed_time, uint32_t clock_frequency)
@@ -116,23 +278,25 @@ double update_energy_harvested(uint64_t elapsed_cycles,
     double &env_voltage,
     std::chrono::nanoseconds &next_charge_time,
     uint32_t clock_freq,
-    ehsim::voltage_trace const &power,
+    ehsim::power_source &power,
     capacitor &battery)
 {
   // execution can span over more than 1 voltage trace sample period
   // accumulate charge of each periods separately
   auto potential_harvested_energy = 0.0;
-  auto cycles_accounted = 0;
+  uint64_t cycles_accounted = 0;
 
   while(exec_end_time >= next_charge_time) {
-    uint64_t cycles_in_cur_charge_rate =
-        elapsed_cycles - time_to_cycles(exec_end_time - next_charge_time, clock_freq);
+    // the cycles from the previous sample boundary, or the start of execution, to this one
+    auto const cycles_after_sample = time_to_cycles(exec_end_time - next_charge_time, clock_freq);
+    uint64_t cycles_in_cur_charge_rate = elapsed_cycles - cycles_after_sample - cycles_accounted;
     potential_harvested_energy += cycles_in_cur_charge_rate * charging_rate;
     cycles_accounted += cycles_in_cur_charge_rate;
 
-    // move to next voltage sample
+    // move to the voltage sample that starts at next_charge_time
+    power.advance();
+    env_voltage = power.voltage();
     next_charge_time += power.sample_period();
-    env_voltage = power.get_voltage(to_milliseconds(next_charge_time));
     charging_rate = calculate_charging_rate(env_voltage, battery, clock_freq);
   }
 
@@ -144,10 +308,59 @@ double update_energy_harvested(uint64_t elapsed_cycles,
   return actual_harvested_energy;
 }
 
-stats_bundle simulate(char const *binary_file,
-    ehsim::voltage_trace const &power,
+double skip_off_period(std::chrono::nanoseconds &time,
+    std::chrono::nanoseconds &next_charge_time,
+    double &charging_rate,
+    double &env_voltage,
+    double min_energy,
+    uint32_t clock_freq,
+    ehsim::power_source &power,
+    capacitor &battery)
+{
+  // the harvesting model is linear in the voltage, and a whole sample always lasts as many cycles
+  auto const rate_per_volt = calculate_charging_rate(1.0, battery, clock_freq);
+  auto const cycles_per_sample = time_to_cycles(power.sample_period(), clock_freq);
+  auto const seconds_per_sample = std::chrono::duration<double>(power.sample_period()).count();
+
+  auto harvested_energy = 0.0;
+  auto skipped = false;
+
+  while(power.skippable_samples() > 0) {
+    // the sum of the voltages of the skipped samples, since each one lasts a whole sample
+    auto const voltage_sum = power.skippable_energy() / seconds_per_sample;
+    auto const energy = voltage_sum * rate_per_volt * cycles_per_sample;
+
+    // stop before the span that lets the device power on, and step through it instead
+    if(battery.energy_stored() + energy >= min_energy) {
+      break;
+    }
+
+    harvested_energy += battery.harvest_energy(energy);
+
+    auto const skipped_time = power.skippable_samples() * power.sample_period();
+    time += skipped_time;
+    next_charge_time += skipped_time;
+
+    power.skip();
+    skipped = true;
+  }
+
+  if(skipped) {
+    env_voltage = power.voltage();
+    charging_rate = calculate_charging_rate(env_voltage, battery, clock_freq);
+  }
+
+  return harvested_energy;
+}
+
+template <bool profiling>
+stats_bundle simulate_with(char const *binary_file,
+    ehsim::power_source &power,
     eh_scheme *scheme,
-    bool always_harvest)
+    bool always_harvest,
+    char const *snapshot_file,
+    energy_profile *profile,
+    call_graph_profile *call_graph)
 {
   using namespace std::chrono_literals;
 
@@ -155,167 +368,338 @@ stats_bundle simulate(char const *binary_file,
   stats_bundle stats{};
   stats.system.time = 0ns;
 
-  initialize_system(binary_file);
+  if(snapshot_file != nullptr) {
+    uint64_t warm_up_instructions = 0u;
+    load_snapshot(snapshot_file, &warm_up_instructions);
+    std::cout << "resumed after " << warm_up_instructions << " warm-up instructions\n";
+  } else {
+    initialize_system(binary_file);
+  }
+  // the loaded data of volatile memory is lost at the first power failure
+  thumbulator::track_loaded_memory();
+
+  if(profiling && call_graph != nullptr) {
+    call_graph->start(thumbulator::cpu_get_pc() - 0x4, thumbulator::cpu_get_gpr(13));
+  }
 
   // energy harvesting
   auto &battery = scheme->get_battery();
   // start in power-off mode
   auto was_active = false;
 
-  // frequency in Hz, sample period in ms
+  // frequency in Hz, sample period in ns
   auto cycles_per_sample = static_cast<uint64_t>(
       scheme->clock_frequency() * std::chrono::duration<double>(power.sample_period()).count());
 
   std::cout.setf(std::ios::unitbuf);
   std::cout << "cycles per sample: " << cycles_per_sample << "\n";
 
-  // get voltage based current time (includes active+sleep) -- this should be @ time 0
-  auto env_voltage = power.get_voltage(to_milliseconds(stats.system.time));
+  // the trace's cursor starts at the sample for time 0
+  auto env_voltage = power.voltage();
   auto charging_rate = calculate_charging_rate(env_voltage, battery, scheme->clock_frequency());
   auto next_charge_time = std::chrono::nanoseconds(power.sample_period());
   std::cout << "next_charge_time: " << next_charge_time.count() << "ns\n";
 
+  // the operating point of the scheme, and the voltage sample it was picked for
+  auto frequency = scheme->clock_frequency();
+  auto operating_voltage = std::numeric_limits<double>::quiet_NaN();
+
   uint64_t active_start = 0u;
   int no_progress_counter = 0;
 
+  // loops are not accelerated when profiling, which counts every instruction
+  thumbulator::loop_accelerator loops;
+  auto const accelerate_loops = thumbulator::ACCELERATE_LOOPS && !profiling;
+  uint32_t loop_branch = 0;
+
+  // runtime helpers execute natively only if the scheme can skip over them
+  thumbulator::native_helper_hook = [scheme, &stats](uint32_t instructions, uint32_t cycles) {
+    return scheme->can_fast_forward(&stats, instructions, cycles);
+  };
+
+  // the application's hypercalls are events for the scheme
+  thumbulator::hypercall_hook = [scheme, &stats](
+      thumbulator::hypercall call, uint32_t r0, uint32_t r1) {
+    scheme->hypercall(&stats, call, r0, r1);
+  };
+
   // Execute the program
   // Simulation will terminate when it executes insn == 0xBFAA
-  while(!thumbulator::EXIT_INSTRUCTION_ENCOUNTERED) {
-    uint64_t elapsed_cycles = 0;
-
-    if(scheme->is_active(&stats)) {
-      if(!was_active) {
-        //std::cout << "["
-        //          << std::chrono::duration_cast<std::chrono::nanoseconds>(stats.system.time).count()
-        //          << "ns - ";
-        // allocate space for a new active period model
-        stats.models.emplace_back();
-        // track the time this active mode started
-        active_start = stats.cpu.cycle_count;
-        stats.models.back().energy_start = battery.energy_stored();
-
-        if(stats.cpu.instruction_count != 0) {
-
-          // restore state
-          auto const restore_time = scheme->restore(&stats);
-          elapsed_cycles += restore_time;
-
-          stats.models.back().time_for_restores += restore_time;
-        }
+  try {
+    while(!thumbulator::EXIT_INSTRUCTION_ENCOUNTERED) {
+      uint64_t elapsed_cycles = 0;
+
+      // the scheme can change its operating point, cycles then last longer or shorter
+      if(env_voltage != operating_voltage) {
+        operating_voltage = env_voltage;
+        scheme->harvested_power(&stats, calculate_charging_rate(env_voltage, battery, 1.0));
+      }
+      if(scheme->clock_frequency() != frequency) {
+        frequency = scheme->clock_frequency();
+        charging_rate = calculate_charging_rate(env_voltage, battery, frequency);
       }
 
-      was_active = true;
+      if(scheme->is_active(&stats)) {
+        if(!was_active) {
+          //std::cout << "["
+          //          << std::chrono::duration_cast<std::chrono::nanoseconds>(stats.system.time).count()
+          //          << "ns - ";
+          // allocate space for a new active period model
+          stats.models.emplace_back();
+          // track the time this active mode started
+          active_start = stats.cpu.cycle_count;
+          stats.models.back().energy_start = battery.energy_stored();
 
-      auto const instruction_ticks = step_cpu();
+          if(stats.cpu.instruction_count != 0) {
 
-      stats.cpu.instruction_count++;
-      stats.cpu.cycle_count += instruction_ticks;
-      stats.models.back().time_for_instructions += instruction_ticks;
-      elapsed_cycles += instruction_ticks;
+            // restore state
+            auto const restore_time = scheme->restore(&stats);
+            elapsed_cycles += restore_time;
 
-      // consume energy for execution
-      scheme->execute_instruction(&stats);
+            stats.models.back().time_for_restores += restore_time;
+          }
+        }
 
-      if(scheme->will_backup(&stats)) {
-        auto const backup_time = scheme->backup(&stats);
-        elapsed_cycles += backup_time;
+        was_active = true;
+
+        if(thumbulator::CPU_IS_SLEEPING) {
+          // skip to the next event, the next sample of the trace, or the cycle the scheme acts in
+          auto const cycles_until_sample = time_to_cycles(
+              next_charge_time - stats.system.time, scheme->clock_frequency());
+          auto const sleep_ticks = scheme->sleep(
+              &stats, std::max<uint64_t>(1, std::min(cycles_until_wake_up(), cycles_until_sample)));
+          auto const exception_ticks = sleep_cpu(sleep_ticks);
+
+          stats.cpu.cycle_count += sleep_ticks + exception_ticks;
+          stats.models.back().time_for_instructions += sleep_ticks + exception_ticks;
+          stats.models.back().time_sleeping += sleep_ticks;
+          elapsed_cycles += sleep_ticks + exception_ticks;
+        } else {
+          uint32_t const pc = profiling ? thumbulator::cpu_get_pc() - 0x4 : 0;
+          uint64_t instruction_ticks = 0;
+          uint64_t instructions = 0;
+          uint32_t back_edge = 0;
+
+          auto run = loop_branch != 0 ? fit_loop(loops, loop_branch, scheme, &stats)
+                                      : thumbulator::loop_run{};
+          if(run.iterations > 0) {
+            // end the run at the iteration whose accesses make the scheme back up or need energy
+            auto const planned = run;
+            run = loops.execute(run, [scheme, &stats, &planned]() {
+              return scheme->will_backup(&stats)
+                     || !scheme->can_fast_forward(&stats, planned.instructions(), planned.cycles());
+            });
+            instruction_ticks = run.cycles();
+            instructions = run.instructions();
+            // every iteration ends with the loop's branch
+            back_edge = run.iterations > 0 ? loop_branch : 0;
+            loop_branch = 0;
+          } else {
+            auto const pc_before = thumbulator::cpu_get_pc();
+            instruction_ticks = step_cpu();
+            instructions = instructions_stepped();
+            back_edge = backward_branch(pc_before);
+            loop_branch = accelerate_loops ? back_edge : 0;
+          }
 
-        auto &active_stats = stats.models.back();
-        active_stats.time_for_backups += backup_time;
-        active_stats.energy_forward_progress = active_stats.energy_for_instructions;
-        active_stats.time_forward_progress = stats.cpu.cycle_count - active_start;
-      }
+          stats.cpu.instruction_count += instructions;
+          stats.cpu.cycle_count += instruction_ticks;
+          stats.models.back().time_for_instructions += instruction_ticks;
+          elapsed_cycles += instruction_ticks;
+
+          // consume energy for execution
+          double const energy_before =
+              profiling ? stats.models.back().energy_for_instructions : 0.0;
+          scheme->execute_instructions(&stats, instructions);
+
+          // loads and stores to the regions of the address map have costs of their own
+          auto const memory_energy = thumbulator::take_memory_energy();
+          if(memory_energy > 0.0) {
+            auto const energy = scheme->memory_access_energy(memory_energy);
+            battery.consume_energy(energy);
+            stats.models.back().energy_for_instructions += energy;
+          }
+
+          if(back_edge != 0) {
+            scheme->back_edge(&stats, back_edge);
+          }
+
+          if(profiling) {
+            auto const energy = stats.models.back().energy_for_instructions - energy_before;
+            auto const cycles = static_cast<uint32_t>(instruction_ticks);
+            if(profile != nullptr) {
+              profile->record(pc, cycles, energy);
+            }
+            if(call_graph != nullptr) {
+              call_graph->record(pc, cycles, energy);
+            }
+          }
+        }
+
+        if(scheme->will_backup(&stats)) {
+          double const backup_energy_before =
+              profiling ? stats.models.back().energy_for_backups : 0.0;
+          auto const backup_time = scheme->backup(&stats);
+          elapsed_cycles += backup_time;
+
+          if(profiling) {
+            if(profile != nullptr) {
+              profile->backup();
+            }
+            if(call_graph != nullptr) {
+              call_graph->backup(stats.models.back().energy_for_backups - backup_energy_before);
+            }
+          }
+
+          auto &active_stats = stats.models.back();
+          active_stats.time_for_backups += backup_time;
+          active_stats.energy_forward_progress = active_stats.energy_for_instructions;
+          active_stats.time_forward_progress = stats.cpu.cycle_count - active_start;
+        }
+
+        stats.system.time += get_time(elapsed_cycles, scheme->clock_frequency());
+
+        if(always_harvest) {
+          // update energy harvested & voltage sample corresponding to current time
+          auto harvested_energy =
+              update_energy_harvested(elapsed_cycles, stats.system.time, charging_rate, env_voltage,
+                  next_charge_time, scheme->clock_frequency(), power, battery);
+          stats.system.energy_harvested += harvested_energy;
+          stats.models.back().energy_charged += harvested_energy;
+        } else {
+          // just update voltage sample value
+          if(stats.system.time >= next_charge_time) {
+            while(stats.system.time >= next_charge_time) {
+              next_charge_time += power.sample_period();
+              power.advance();
+            }
+
+            env_voltage = power.voltage();
+            charging_rate =
+                calculate_charging_rate(env_voltage, battery, scheme->clock_frequency());
+          }
+        }
+      } else { // powered off
+        if(was_active) {
+          //std::cout << std::chrono::duration_cast<std::chrono::nanoseconds>(stats.system.time).count()
+          //          << "ns]\n";
+          // we just powered off
+          auto &active_period = stats.models.back();
+          loop_branch = 0;
+          thumbulator::power_off_memory();
+
+          if(profiling) {
+            if(profile != nullptr) {
+              profile->power_off();
+            }
+            if(call_graph != nullptr) {
+              call_graph->power_off();
+            }
+          }
+
+          // ensure forward progress is being made, otherwise throw
+          //ensure_forward_progress(&no_progress_counter, active_period.num_backups, 5);
+
+          active_period.time_total = active_period.time_for_instructions +
+                                     active_period.time_for_backups +
+                                     active_period.time_for_restores;
+
+          active_period.energy_consumed = active_period.energy_for_instructions +
+                                          active_period.energy_for_backups +
+                                          active_period.energy_for_restore;
+
+          active_period.progress =
+              active_period.energy_forward_progress / active_period.energy_consumed;
+          active_period.eh_progress = scheme->estimate_progress(eh_model_parameters(active_period));
+        }
+
+        was_active = false;
+
+        // figure out how long to be off for
+        // move in steps of voltage sample (1ms)
+        double const min_energy = scheme->min_energy_to_power_on(&stats);
+
+        // at the start of a sample, skip spans of the trace with a precomputed energy
+        if(stats.system.time + power.sample_period() == next_charge_time) {
+          stats.system.energy_harvested +=
+              skip_off_period(stats.system.time, next_charge_time, charging_rate, env_voltage,
+                  min_energy, scheme->clock_frequency(), power, battery);
+        }
+
+        double const min_voltage = sqrt(2 * min_energy / battery.capacitance());
 
-      stats.system.time += get_time(elapsed_cycles, scheme->clock_frequency());
+        // assume linear max dV/dt for now
+        double const max_dV_dt = battery.max_current() / battery.capacitance();
+        double const dV_dt_per_cycle = max_dV_dt / scheme->clock_frequency();
+        auto const min_cycles =
+            static_cast<uint64_t>(ceil((min_voltage - battery.voltage()) / dV_dt_per_cycle));
+
+        auto time_until_next_charge = next_charge_time - stats.system.time;
+        uint64_t cycles_until_next_charge =
+            time_to_cycles(time_until_next_charge, scheme->clock_frequency());
+
+        if(min_cycles > cycles_until_next_charge) {
+          stats.system.time = next_charge_time;
+          elapsed_cycles = cycles_until_next_charge;
+        } else {
+          elapsed_cycles = min_cycles;
+          stats.system.time += get_time(elapsed_cycles, scheme->clock_frequency());
+        }
 
-      if(always_harvest) {
         // update energy harvested & voltage sample corresponding to current time
         auto harvested_energy =
             update_energy_harvested(elapsed_cycles, stats.system.time, charging_rate, env_voltage,
                 next_charge_time, scheme->clock_frequency(), power, battery);
         stats.system.energy_harvested += harvested_energy;
-        stats.models.back().energy_charged += harvested_energy;
-      } else {
-        // just update voltage sample value
-        if(stats.system.time >= next_charge_time) {
-          while(stats.system.time >= next_charge_time) {
-            next_charge_time += power.sample_period();
-          }
-
-          env_voltage = power.get_voltage(to_milliseconds(stats.system.time));
-          charging_rate = calculate_charging_rate(env_voltage, battery, scheme->clock_frequency());
-        }
-      }
-    } else { // powered off
-      if(was_active) {
-        //std::cout << std::chrono::duration_cast<std::chrono::nanoseconds>(stats.system.time).count()
-        //          << "ns]\n";
-        // we just powered off
-        auto &active_period = stats.models.back();
-
-        // ensure forward progress is being made, otherwise throw
-        //ensure_forward_progress(&no_progress_counter, active_period.num_backups, 5);
-
-        active_period.time_total = active_period.time_for_instructions +
-                                   active_period.time_for_backups + active_period.time_for_restores;
-
-        active_period.energy_consumed = active_period.energy_for_instructions +
-                                        active_period.energy_for_backups +
-                                        active_period.energy_for_restore;
-
-        active_period.progress =
-            active_period.energy_forward_progress / active_period.energy_consumed;
-        active_period.eh_progress = scheme->estimate_progress(eh_model_parameters(active_period));
       }
-
-      was_active = false;
-
-      // figure out how long to be off for
-      // move in steps of voltage sample (1ms)
-      double const min_energy = scheme->min_energy_to_power_on(&stats);
-      double const min_voltage = sqrt(2 * min_energy / battery.capacitance());
-
-      // assume linear max dV/dt for now
-      double const max_dV_dt = battery.max_current() / battery.capacitance();
-      double const dV_dt_per_cycle = max_dV_dt / scheme->clock_frequency();
-      auto const min_cycles =
-          static_cast<uint64_t>(ceil((min_voltage - battery.voltage()) / dV_dt_per_cycle));
-
-      auto time_until_next_charge = next_charge_time - stats.system.time;
-      uint64_t cycles_until_next_charge =
-          time_to_cycles(time_until_next_charge, scheme->clock_frequency());
-
-      if(min_cycles > cycles_until_next_charge) {
-        stats.system.time = next_charge_time;
-        elapsed_cycles = cycles_until_next_charge;
-      } else {
-        elapsed_cycles = min_cycles;
-        auto elapsed_time = std::chrono::nanoseconds(
-            static_cast<uint64_t>(elapsed_cycles * scheme->clock_frequency() * 1e9));
-        stats.system.time += elapsed_time;
-      }
-
-      // update energy harvested & voltage sample corresponding to current time
-      auto harvested_energy = update_energy_harvested(elapsed_cycles, stats.system.time,
-          charging_rate, env_voltage, next_charge_time, scheme->clock_frequency(), power, battery);
-      stats.system.energy_harvested += harvested_energy;
     }
+  } catch(thumbulator::fault const &fault) {
+    // report the fault with this simulation's statistics instead of ending the process
+    stats.fault.faulted = true;
+    stats.fault.reason = fault.what();
+    stats.fault.pc = fault.pc();
+    stats.fault.address = fault.address();
+    stats.fault.opcode = fault.opcode();
   }
   std::cout << "done\n";
 
-  auto &active_period = stats.models.back();
-  active_period.time_total = active_period.time_for_instructions + active_period.time_for_backups +
-                             active_period.time_for_restores;
+  thumbulator::native_helper_hook = nullptr;
+  thumbulator::hypercall_hook = nullptr;
 
-  active_period.energy_consumed = active_period.energy_for_instructions +
-                                  active_period.energy_for_backups +
-                                  active_period.energy_for_restore;
+  if(!stats.models.empty()) {
+    auto &active_period = stats.models.back();
+    active_period.time_total = active_period.time_for_instructions +
+                               active_period.time_for_backups + active_period.time_for_restores;
 
-  active_period.progress = active_period.energy_forward_progress / active_period.energy_consumed;
-  active_period.eh_progress = scheme->estimate_progress(eh_model_parameters(active_period));
+    active_period.energy_consumed = active_period.energy_for_instructions +
+                                    active_period.energy_for_backups +
+                                    active_period.energy_for_restore;
+
+    active_period.progress =
+        active_period.energy_forward_progress / active_period.energy_consumed;
+    active_period.eh_progress = scheme->estimate_progress(eh_model_parameters(active_period));
+  }
 
   stats.system.energy_remaining = battery.energy_stored();
 
   return stats;
 }
+
+stats_bundle simulate(char const *binary_file,
+    ehsim::power_source &power,
+    eh_scheme *scheme,
+    bool always_harvest,
+    char const *snapshot_file,
+    energy_profile *profile,
+    call_graph_profile *call_graph)
+{
+  // profiling is compiled out of the simulation loop unless it is enabled
+  if(profile != nullptr || call_graph != nullptr) {
+    return simulate_with<true>(
+        binary_file, power, scheme, always_harvest, snapshot_file, profile, call_graph);
+  }
+
+  return simulate_with<false>(
+      binary_file, power, scheme, always_harvest, snapshot_file, nullptr, nullptr);
+}
 }
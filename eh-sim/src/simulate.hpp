@@ -6,9 +6,26 @@
 
 namespace ehsim {
 
+class call_graph_profile;
 class eh_scheme;
+class energy_profile;
+class power_source;
+struct cpu_stats;
+struct execution_point;
 struct stats_bundle;
-class voltage_trace;
+
+/**
+ * Execute an application without an energy harvesting model and save its state.
+ *
+ * @param binary_file The path to the application binary file.
+ * @param until The point of execution to stop at.
+ * @param snapshot_file The path to save the snapshot to.
+ *
+ * @return The statistics of the instructions executed to reach the snapshot.
+ */
+cpu_stats fast_forward(char const *binary_file,
+    execution_point const &until,
+    char const *snapshot_file);
 
 /**
  * Simulate an energy harvesting device.
@@ -17,13 +34,19 @@ class voltage_trace;
  * @param power The power supply over time.
  * @param scheme The energy harvesting scheme to use.
  * @param always_harvest true to harvest always, false to harvest during off periods only.
+ * @param snapshot_file The path to a snapshot to start from, or nullptr to start from reset.
+ * @param profile The profile to attribute execution and energy to, or nullptr to not profile.
+ * @param call_graph The profile to attribute them to call stacks, or nullptr to not profile.
  *
  * @return The statistics tracked during the simulation.
  */
 stats_bundle simulate(char const *binary_file,
-    ehsim::voltage_trace const &power,
+    ehsim::power_source &power,
     eh_scheme *scheme,
-    bool always_harvest);
+    bool always_harvest,
+    char const *snapshot_file,
+    energy_profile *profile,
+    call_graph_profile *call_graph);
 }
 
 #endif //EH_SIM_SIMULATE_HPP
@@ -0,0 +1,236 @@
+#include "snapshot.hpp"
+
+#include <thumbulator/cpu.hpp>
+#include <thumbulator/exception.hpp>
+#include <thumbulator/hle.hpp>
+#include <thumbulator/memory.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ehsim {
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'E', 'H', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 3;
+
+// the runtime helpers were trapped, and flash holds the traps instead of their instructions
+constexpr uint32_t SNAPSHOT_NATIVE_HELPERS = 0x1;
+// the CPU was asleep in wfi or wfe, and the event register of wfe and sev
+constexpr uint32_t SNAPSHOT_SLEEPING = 0x2;
+constexpr uint32_t SNAPSHOT_EVENT_REGISTER = 0x4;
+
+// memory is saved sparsely, one page at a time
+constexpr uint32_t PAGE_SIZE_ELEMENTS = 1024;
+constexpr uint32_t PAGE_SIZE_BYTES = PAGE_SIZE_ELEMENTS * sizeof(uint32_t);
+
+enum region_tag : uint32_t { region_flash = 0, region_ram = 1, region_end = 0xFFFFFFFF };
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t cpu_state_size;
+  uint32_t flash_size_bytes;
+  uint32_t ram_size_bytes;
+  uint64_t instruction_count;
+  uint64_t cycle_count;
+  uint32_t flags;
+  uint32_t displaced_count;
+};
+
+/**
+ * An instruction that a trap in flash replaced.
+ */
+struct displaced_entry {
+  uint32_t address;
+  uint32_t instruction;
+};
+
+struct page_header {
+  uint32_t region;
+  uint32_t page;
+};
+
+void write(std::FILE *fd, void const *data, size_t size)
+{
+  if(std::fwrite(data, 1, size, fd) != size) {
+    throw std::runtime_error("Could not write to snapshot file.");
+  }
+}
+
+void read(std::FILE *fd, void *data, size_t size)
+{
+  if(std::fread(data, 1, size, fd) != size) {
+    throw std::runtime_error("Snapshot file is truncated.");
+  }
+}
+
+void write_pages(std::FILE *fd, region_tag region, uint32_t const *memory, size_t elements)
+{
+  for(uint32_t page = 0; page < elements / PAGE_SIZE_ELEMENTS; ++page) {
+    auto const begin = memory + page * PAGE_SIZE_ELEMENTS;
+    auto const end = begin + PAGE_SIZE_ELEMENTS;
+
+    // memory is zero after a reset, so untouched pages do not need to be saved
+    if(std::all_of(begin, end, [](uint32_t word) { return word == 0; })) {
+      continue;
+    }
+
+    page_header const header{region, page};
+    write(fd, &header, sizeof(header));
+    write(fd, begin, PAGE_SIZE_BYTES);
+  }
+}
+}
+
+execution_point parse_execution_point(std::string const &point)
+{
+  execution_point result;
+
+  try {
+    if(point.compare(0, 3, "pc:") == 0) {
+      result.at_pc = true;
+      result.pc = static_cast<uint32_t>(std::stoul(point.substr(3), nullptr, 16));
+    } else {
+      result.instruction_count = std::stoull(point);
+    }
+  } catch(std::logic_error const &) {
+    throw std::runtime_error("Invalid execution point: " + point);
+  }
+
+  return result;
+}
+
+void save_snapshot(std::string const &path_to_snapshot,
+    uint64_t instruction_count,
+    uint64_t cycle_count)
+{
+  std::FILE *fd = std::fopen(path_to_snapshot.c_str(), "wb");
+  if(fd == nullptr) {
+    throw std::runtime_error("Could not open snapshot file: " + path_to_snapshot);
+  }
+
+  try {
+    snapshot_header header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.cpu_state_size = sizeof(thumbulator::cpu_state);
+    header.flash_size_bytes = FLASH_SIZE_BYTES;
+    header.ram_size_bytes = RAM_SIZE_BYTES;
+    header.instruction_count = instruction_count;
+    header.cycle_count = cycle_count;
+
+    auto const displaced = thumbulator::displaced_instructions();
+    header.flags = (thumbulator::INTERCEPT_RUNTIME_HELPERS ? SNAPSHOT_NATIVE_HELPERS : 0)
+                   | (thumbulator::CPU_IS_SLEEPING ? SNAPSHOT_SLEEPING : 0)
+                   | (thumbulator::EVENT_REGISTER ? SNAPSHOT_EVENT_REGISTER : 0);
+    header.displaced_count = static_cast<uint32_t>(displaced.size());
+    write(fd, &header, sizeof(header));
+
+    write(fd, &thumbulator::cpu, sizeof(thumbulator::cpu));
+    thumbulator::systick_update();
+    write(fd, &thumbulator::SYSTICK, sizeof(thumbulator::SYSTICK));
+
+    for(auto const &instruction : displaced) {
+      displaced_entry const entry{instruction.first, instruction.second};
+      write(fd, &entry, sizeof(entry));
+    }
+
+    write_pages(fd, region_flash, thumbulator::FLASH_MEMORY, FLASH_SIZE_ELEMENTS);
+    write_pages(fd, region_ram, thumbulator::RAM, RAM_SIZE_ELEMENTS);
+
+    page_header const end{region_end, 0};
+    write(fd, &end, sizeof(end));
+  } catch(...) {
+    std::fclose(fd);
+    throw;
+  }
+
+  std::fclose(fd);
+}
+
+void load_snapshot(std::string const &path_to_snapshot, uint64_t *instruction_count)
+{
+  std::FILE *fd = std::fopen(path_to_snapshot.c_str(), "rb");
+  if(fd == nullptr) {
+    throw std::runtime_error("Could not open snapshot file: " + path_to_snapshot);
+  }
+
+  try {
+    snapshot_header header{};
+    read(fd, &header, sizeof(header));
+
+    if(std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+      throw std::runtime_error("Not a snapshot file: " + path_to_snapshot);
+    }
+
+    if(header.version != SNAPSHOT_VERSION || header.cpu_state_size != sizeof(thumbulator::cpu_state)
+        || header.flash_size_bytes != FLASH_SIZE_BYTES || header.ram_size_bytes != RAM_SIZE_BYTES) {
+      throw std::runtime_error("Snapshot was created by an incompatible simulator.");
+    }
+
+    // flash holds the traps, which only execute as the snapshot expects with the same setting
+    auto const native_helpers = (header.flags & SNAPSHOT_NATIVE_HELPERS) != 0;
+    if(native_helpers != thumbulator::INTERCEPT_RUNTIME_HELPERS) {
+      throw std::runtime_error(native_helpers
+                                   ? "Snapshot was created with --native-helpers."
+                                   : "Snapshot was created without --native-helpers.");
+    }
+
+    *instruction_count = header.instruction_count;
+
+    read(fd, &thumbulator::cpu, sizeof(thumbulator::cpu));
+    read(fd, &thumbulator::SYSTICK, sizeof(thumbulator::SYSTICK));
+    thumbulator::CPU_IS_SLEEPING = (header.flags & SNAPSHOT_SLEEPING) != 0;
+    thumbulator::EVENT_REGISTER = (header.flags & SNAPSHOT_EVENT_REGISTER) != 0;
+
+    std::vector<std::pair<uint32_t, uint16_t>> displaced;
+    for(uint32_t i = 0; i < header.displaced_count; ++i) {
+      displaced_entry entry{};
+      read(fd, &entry, sizeof(entry));
+      displaced.emplace_back(entry.address, static_cast<uint16_t>(entry.instruction));
+    }
+    thumbulator::set_displaced_instructions(displaced);
+
+    std::memset(thumbulator::RAM, 0, sizeof(thumbulator::RAM));
+    std::memset(thumbulator::FLASH_MEMORY, 0, sizeof(thumbulator::FLASH_MEMORY));
+
+    page_header page{};
+    read(fd, &page, sizeof(page));
+    while(page.region != region_end) {
+      uint32_t *memory = nullptr;
+      size_t pages = 0;
+      if(page.region == region_flash) {
+        memory = thumbulator::FLASH_MEMORY;
+        pages = FLASH_SIZE_ELEMENTS / PAGE_SIZE_ELEMENTS;
+      } else if(page.region == region_ram) {
+        memory = thumbulator::RAM;
+        pages = RAM_SIZE_ELEMENTS / PAGE_SIZE_ELEMENTS;
+      }
+
+      if(memory == nullptr || page.page >= pages) {
+        throw std::runtime_error("Snapshot file is corrupt.");
+      }
+
+      read(fd, memory + page.page * PAGE_SIZE_ELEMENTS, PAGE_SIZE_BYTES);
+      read(fd, &page, sizeof(page));
+    }
+  } catch(...) {
+    std::fclose(fd);
+    throw;
+  }
+
+  std::fclose(fd);
+
+  thumbulator::BRANCH_WAS_TAKEN = false;
+  thumbulator::EXIT_INSTRUCTION_ENCOUNTERED = false;
+  thumbulator::systick_resume();
+  // an exception pending in the saved state is taken after the first instruction
+  thumbulator::check_pending_exceptions();
+}
+}
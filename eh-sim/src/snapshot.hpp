@@ -0,0 +1,58 @@
+#ifndef EH_SIM_SNAPSHOT_HPP
+#define EH_SIM_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace ehsim {
+
+/**
+ * A point in the execution of an application.
+ */
+struct execution_point {
+  /**
+   * Stop after this many instructions have executed.
+   */
+  uint64_t instruction_count = 0u;
+
+  /**
+   * Stop when the next instruction to execute is at this address.
+   */
+  uint32_t pc = 0u;
+
+  /**
+   * true to stop at the PC, false to stop at the instruction count.
+   */
+  bool at_pc = false;
+};
+
+/**
+ * Parse an execution point from the command line.
+ *
+ * @param point Either an instruction count, or an address formatted as pc:0xADDRESS.
+ *
+ * @return The parsed execution point.
+ */
+execution_point parse_execution_point(std::string const &point);
+
+/**
+ * Save the architectural and memory state of the CPU to a file.
+ *
+ * @param path_to_snapshot The file to write the snapshot to.
+ * @param instruction_count The number of instructions executed to reach this state.
+ * @param cycle_count The number of cycles executed to reach this state.
+ */
+void save_snapshot(std::string const &path_to_snapshot,
+    uint64_t instruction_count,
+    uint64_t cycle_count);
+
+/**
+ * Restore the architectural and memory state of the CPU from a file.
+ *
+ * @param path_to_snapshot Path to a snapshot created by save_snapshot.
+ * @param instruction_count The number of instructions executed to reach the snapshot.
+ */
+void load_snapshot(std::string const &path_to_snapshot, uint64_t *instruction_count);
+}
+
+#endif //EH_SIM_SNAPSHOT_HPP
@@ -2,7 +2,9 @@
 #define EH_SIM_STATS_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <deque>
+#include <string>
 
 namespace ehsim {
 struct cpu_stats {
@@ -35,6 +37,33 @@ struct system_stats {
 
 };
 
+struct fault_stats {
+  /**
+   * true if the simulation was ended by a fault instead of the exit instruction.
+   */
+  bool faulted = false;
+
+  /**
+   * Description of the fault.
+   */
+  std::string reason;
+
+  /**
+   * Address of the faulting instruction.
+   */
+  uint32_t pc = 0u;
+
+  /**
+   * The address that was accessed, or the target of a branch.
+   */
+  uint32_t address = 0u;
+
+  /**
+   * The faulting instruction.
+   */
+  uint16_t opcode = 0u;
+};
+
 struct active_stats {
   /**
    * The accumulated cycle count of the time between all backups.
@@ -61,6 +90,11 @@ struct active_stats {
    */
   uint64_t time_for_instructions = 0u;
 
+  /**
+   * The cycles the CPU slept in wfi or wfe, part of the cycles of this active period.
+   */
+  uint64_t time_sleeping = 0u;
+
   /**
    * The total cycles of this active period.
    */
@@ -101,6 +135,11 @@ struct active_stats {
    */
   double energy_for_instructions = 0.0;
 
+  /**
+   * The energy (nJ) spent sleeping in wfi or wfe, part of the energy spent on instructions.
+   */
+  double energy_for_sleep = 0.0;
+
   /**
    * Energy spent on executing instructions that were backed up.
    */
@@ -150,6 +189,20 @@ struct eh_model_parameters {
     }
   }
 
+  /**
+   * The parameters of an active period, had it backed up with a different period.
+   */
+  eh_model_parameters(eh_model_parameters const &parameters, double backup_period)
+      : E(parameters.E)
+      , epsilon(parameters.epsilon)
+      , epsilon_C(parameters.epsilon_C)
+      , tau_B(backup_period)
+      , alpha_B(parameters.alpha_B)
+      , alpha_R(parameters.alpha_R)
+      , do_restore(parameters.do_restore)
+  {
+  }
+
   double E;
 
   double const epsilon;
@@ -168,6 +221,7 @@ struct eh_model_parameters {
 struct stats_bundle {
   system_stats system;
   cpu_stats cpu;
+  fault_stats fault;
 
   /**
    * Model of multiple active periods.
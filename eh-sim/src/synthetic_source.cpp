@@ -0,0 +1,344 @@
+#include "synthetic_source.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace ehsim {
+
+namespace {
+
+// how far the cursor may skip at once
+constexpr uint64_t SYNTHETIC_SKIP_SPAN = 4096;
+
+constexpr double PI = 3.14159265358979323846;
+
+std::vector<std::string> split(std::string const &text, char delimiter)
+{
+  std::vector<std::string> parts;
+
+  std::istringstream stream(text);
+  std::string part;
+  while(std::getline(stream, part, delimiter)) {
+    parts.push_back(part);
+  }
+
+  return parts;
+}
+
+double parse_number(std::string const &text, std::string const &description)
+{
+  try {
+    size_t end = 0;
+    auto const value = std::stod(text, &end);
+    if(end == text.size()) {
+      return value;
+    }
+  } catch(std::logic_error const &) {
+  }
+
+  throw std::runtime_error("Invalid synthetic source: " + description);
+}
+
+void ensure_not_negative(double voltage)
+{
+  if(voltage < 0) {
+    throw std::runtime_error("Synthetic sources cannot have a negative voltage.");
+  }
+}
+}
+
+synthetic_source::synthetic_source(std::chrono::nanoseconds const &sample_period)
+    : period(sample_period)
+    , sample(0)
+    , start_energy(0)
+    , end_energy(0)
+    , current_voltage(0)
+{
+  if(period.count() <= 0) {
+    throw std::runtime_error("Synthetic sources need a positive sample period.");
+  }
+}
+
+void synthetic_source::start()
+{
+  move_to(0);
+}
+
+void synthetic_source::advance()
+{
+  ++sample;
+  discard_until(time_of(sample));
+
+  start_energy = end_energy;
+  end_energy = energy_until(time_of(sample + 1));
+
+  // rounding must not make the voltage negative
+  current_voltage = std::max(0.0, (end_energy - start_energy) / time_of(1));
+}
+
+uint64_t synthetic_source::skippable_samples() const
+{
+  return SYNTHETIC_SKIP_SPAN;
+}
+
+double synthetic_source::skippable_energy() const
+{
+  return std::max(0.0, energy_until(time_of(sample + SYNTHETIC_SKIP_SPAN)) - start_energy);
+}
+
+void synthetic_source::skip()
+{
+  move_to(sample + SYNTHETIC_SKIP_SPAN);
+}
+
+double synthetic_source::time_of(uint64_t sample_index) const
+{
+  return std::chrono::duration<double>(period).count() * sample_index;
+}
+
+void synthetic_source::move_to(uint64_t sample_index)
+{
+  sample = sample_index;
+  discard_until(time_of(sample));
+
+  start_energy = energy_until(time_of(sample));
+  end_energy = energy_until(time_of(sample + 1));
+  current_voltage = std::max(0.0, (end_energy - start_energy) / time_of(1));
+}
+
+constant_source::constant_source(std::chrono::nanoseconds const &sample_period, double voltage)
+    : synthetic_source(sample_period)
+    , level(voltage)
+{
+  ensure_not_negative(level);
+
+  start();
+}
+
+double constant_source::energy_until(double time) const
+{
+  return level * time;
+}
+
+square_source::square_source(std::chrono::nanoseconds const &sample_period,
+    double low,
+    double high,
+    double wave_period,
+    double duty_cycle)
+    : synthetic_source(sample_period)
+    , low(low)
+    , high(high)
+    , wave_period(wave_period)
+    , high_time(wave_period * duty_cycle)
+{
+  ensure_not_negative(low);
+  ensure_not_negative(high);
+
+  if(wave_period <= 0 || duty_cycle < 0 || duty_cycle > 1) {
+    throw std::runtime_error("Square waves need a positive period and a duty cycle in [0, 1].");
+  }
+
+  start();
+}
+
+double square_source::energy_until(double time) const
+{
+  auto const periods = std::floor(time / wave_period);
+  auto const remainder = time - periods * wave_period;
+
+  auto const per_period = high * high_time + low * (wave_period - high_time);
+  auto const partial =
+      high * std::min(remainder, high_time) + low * std::max(0.0, remainder - high_time);
+
+  return periods * per_period + partial;
+}
+
+sine_source::sine_source(std::chrono::nanoseconds const &sample_period,
+    double offset,
+    double amplitude,
+    double wave_period)
+    : synthetic_source(sample_period)
+    , offset(offset)
+    , amplitude(amplitude)
+    , wave_period(wave_period)
+{
+  if(amplitude < 0 || offset < amplitude) {
+    throw std::runtime_error("Sine waves need 0 <= amplitude <= offset.");
+  }
+
+  if(wave_period <= 0) {
+    throw std::runtime_error("Sine waves need a positive period.");
+  }
+
+  start();
+}
+
+double sine_source::energy_until(double time) const
+{
+  // reduce the angle first, so it stays precise after a long simulation
+  auto const angle = 2 * PI * std::fmod(time, wave_period) / wave_period;
+
+  return offset * time + amplitude * wave_period / (2 * PI) * (1 - std::cos(angle));
+}
+
+piecewise_linear_source::piecewise_linear_source(std::chrono::nanoseconds const &sample_period,
+    std::vector<std::pair<double, double>> const &points)
+    : synthetic_source(sample_period)
+    , points(points)
+    , cumulative(1, 0.0)
+{
+  if(points.size() < 2 || points.front().first != 0) {
+    throw std::runtime_error("Piecewise-linear sources need at least two points from time zero.");
+  }
+
+  for(size_t i = 1; i < points.size(); ++i) {
+    auto const &from = points[i - 1];
+    auto const &to = points[i];
+    if(to.first <= from.first) {
+      throw std::runtime_error("Piecewise-linear points must be in increasing time order.");
+    }
+
+    auto const area = (to.first - from.first) * (from.second + to.second) / 2;
+    cumulative.push_back(cumulative.back() + area);
+  }
+
+  for(auto const &point : points) {
+    ensure_not_negative(point.second);
+  }
+
+  start();
+}
+
+double piecewise_linear_source::energy_until(double time) const
+{
+  auto const length = points.back().first;
+  auto const repeats = std::floor(time / length);
+  auto const remainder = time - repeats * length;
+
+  // the segment that contains the remainder
+  auto const after = std::upper_bound(points.begin() + 1, points.end() - 1, remainder,
+      [](double t, std::pair<double, double> const &point) { return t < point.first; });
+  auto const segment = static_cast<size_t>(after - points.begin());
+
+  auto const &from = points[segment - 1];
+  auto const &to = points[segment];
+  auto const slope = (to.second - from.second) / (to.first - from.first);
+  auto const voltage = from.second + slope * (remainder - from.first);
+
+  return repeats * cumulative.back() + cumulative[segment - 1]
+         + (remainder - from.first) * (from.second + voltage) / 2;
+}
+
+burst_source::burst_source(std::chrono::nanoseconds const &sample_period,
+    uint64_t seed,
+    double rate,
+    double duration,
+    double high,
+    double low)
+    : synthetic_source(sample_period)
+    , duration(duration)
+    , high(high)
+    , low(low)
+    , generator(seed)
+    , gap(rate > 0 ? rate : 1.0)
+    , base_time(0)
+    , base_energy(0)
+{
+  ensure_not_negative(low);
+  ensure_not_negative(high);
+
+  if(rate <= 0 || duration < 0) {
+    throw std::runtime_error("Bursts need a positive rate and a duration of at least zero.");
+  }
+
+  start();
+}
+
+double burst_source::energy_until(double time) const
+{
+  auto energy = base_energy;
+  auto now = base_time;
+
+  for(size_t i = 0;; ++i) {
+    if(i == burst_starts.size()) {
+      burst_starts.push_back(now + gap(generator));
+    }
+
+    auto const burst_start = burst_starts[i];
+    if(time <= burst_start) {
+      return energy + low * (time - now);
+    }
+
+    energy += low * (burst_start - now);
+    if(time <= burst_start + duration) {
+      return energy + high * (time - burst_start);
+    }
+
+    energy += high * duration;
+    now = burst_start + duration;
+  }
+}
+
+void burst_source::discard_until(double time)
+{
+  while(!burst_starts.empty() && burst_starts.front() + duration <= time) {
+    auto const burst_start = burst_starts.front();
+    burst_starts.pop_front();
+
+    base_energy += low * (burst_start - base_time) + high * duration;
+    base_time = burst_start + duration;
+  }
+}
+
+std::unique_ptr<power_source> make_synthetic_source(std::string const &description,
+    std::chrono::nanoseconds const &sample_period)
+{
+  auto const colon = description.find(':');
+  auto const kind = description.substr(0, colon);
+  auto const parameters = colon == std::string::npos ? std::vector<std::string>()
+                                                      : split(description.substr(colon + 1), ',');
+
+  std::vector<double> values;
+  if(kind != "pwl") {
+    for(auto const &parameter : parameters) {
+      values.push_back(parse_number(parameter, description));
+    }
+  }
+
+  if(kind == "constant" && values.size() == 1) {
+    return std::make_unique<constant_source>(sample_period, values[0]);
+  } else if(kind == "square" && values.size() == 4) {
+    return std::make_unique<square_source>(sample_period, values[0], values[1], values[2], values[3]);
+  } else if(kind == "sine" && values.size() == 3) {
+    return std::make_unique<sine_source>(sample_period, values[0], values[1], values[2]);
+  } else if(kind == "bursts" && values.size() == 5) {
+    // the seed must not go through a double, or large seeds would collide
+    uint64_t seed = 0;
+    try {
+      seed = std::stoull(parameters[0]);
+    } catch(std::logic_error const &) {
+      throw std::runtime_error("Invalid synthetic source: " + description);
+    }
+
+    return std::make_unique<burst_source>(
+        sample_period, seed, values[1], values[2], values[3], values[4]);
+  } else if(kind == "pwl") {
+    std::vector<std::pair<double, double>> points;
+    for(auto const &parameter : parameters) {
+      auto const point = split(parameter, '=');
+      if(point.size() != 2) {
+        throw std::runtime_error("Invalid synthetic source: " + description);
+      }
+
+      points.emplace_back(
+          parse_number(point[0], description), parse_number(point[1], description));
+    }
+
+    return std::make_unique<piecewise_linear_source>(sample_period, points);
+  }
+
+  throw std::runtime_error("Invalid synthetic source: " + description);
+}
+}
@@ -0,0 +1,243 @@
+#ifndef EH_SIM_SYNTHETIC_SOURCE_HPP
+#define EH_SIM_SYNTHETIC_SOURCE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "power_source.hpp"
+
+namespace ehsim {
+
+/**
+ * A power source defined by a closed-form integral of its voltage.
+ *
+ * The voltage of each sample is the mean voltage over the sample period, so the energy of any
+ * span of samples is the difference of two integrals and can always be skipped.
+ */
+class synthetic_source : public power_source {
+public:
+  double voltage() const override
+  {
+    return current_voltage;
+  }
+
+  void advance() override;
+
+  std::chrono::nanoseconds sample_period() const override
+  {
+    return period;
+  }
+
+  uint64_t skippable_samples() const override;
+
+  double skippable_energy() const override;
+
+  void skip() override;
+
+protected:
+  /**
+   * Constructor.
+   *
+   * @param sample_period The time between samples.
+   */
+  explicit synthetic_source(std::chrono::nanoseconds const &sample_period);
+
+  /**
+   * Start the cursor at the first sample, once the source can be integrated.
+   */
+  void start();
+
+  /**
+   * Integrate the voltage from time zero.
+   *
+   * Calls never ask for a time before the start of the cursor's sample.
+   *
+   * @param time The end of the integral in seconds.
+   *
+   * @return The integral in volt-seconds.
+   */
+  virtual double energy_until(double time) const = 0;
+
+  /**
+   * Called when the cursor moves, no later call to energy_until asks for an earlier time.
+   *
+   * @param time The start of the cursor's sample in seconds.
+   */
+  virtual void discard_until(double time)
+  {
+  }
+
+private:
+  std::chrono::nanoseconds period;
+
+  // the cursor, and the integral at the start and end of its sample
+  uint64_t sample;
+  double start_energy;
+  double end_energy;
+  double current_voltage;
+
+  double time_of(uint64_t sample_index) const;
+
+  void move_to(uint64_t sample_index);
+};
+
+/**
+ * A constant voltage.
+ */
+class constant_source : public synthetic_source {
+public:
+  constant_source(std::chrono::nanoseconds const &sample_period, double voltage);
+
+protected:
+  double energy_until(double time) const override;
+
+private:
+  double level;
+};
+
+/**
+ * A square wave, or pulse-width modulated supply.
+ */
+class square_source : public synthetic_source {
+public:
+  /**
+   * Constructor.
+   *
+   * @param sample_period The time between samples.
+   * @param low The voltage while the wave is low.
+   * @param high The voltage while the wave is high.
+   * @param wave_period The period of the wave in seconds.
+   * @param duty_cycle The fraction of each period the wave is high, starting with high.
+   */
+  square_source(std::chrono::nanoseconds const &sample_period,
+      double low,
+      double high,
+      double wave_period,
+      double duty_cycle);
+
+protected:
+  double energy_until(double time) const override;
+
+private:
+  double low;
+  double high;
+  double wave_period;
+  double high_time;
+};
+
+/**
+ * A sine wave around an offset, such as the sun over a day.
+ */
+class sine_source : public synthetic_source {
+public:
+  /**
+   * Constructor.
+   *
+   * @param sample_period The time between samples.
+   * @param offset The mean voltage.
+   * @param amplitude The amplitude, at most the offset so the voltage is never negative.
+   * @param wave_period The period of the wave in seconds.
+   */
+  sine_source(std::chrono::nanoseconds const &sample_period,
+      double offset,
+      double amplitude,
+      double wave_period);
+
+protected:
+  double energy_until(double time) const override;
+
+private:
+  double offset;
+  double amplitude;
+  double wave_period;
+};
+
+/**
+ * Straight lines between points in time, repeated after the last point.
+ */
+class piecewise_linear_source : public synthetic_source {
+public:
+  /**
+   * Constructor.
+   *
+   * @param sample_period The time between samples.
+   * @param points Pairs of time in seconds and voltage, starting at time zero.
+   */
+  piecewise_linear_source(std::chrono::nanoseconds const &sample_period,
+      std::vector<std::pair<double, double>> const &points);
+
+protected:
+  double energy_until(double time) const override;
+
+private:
+  std::vector<std::pair<double, double>> points;
+
+  // the integral from time zero to each point
+  std::vector<double> cumulative;
+};
+
+/**
+ * Bursts of a fixed length that arrive as a Poisson process, such as a duty-cycled RF source.
+ */
+class burst_source : public synthetic_source {
+public:
+  /**
+   * Constructor.
+   *
+   * @param sample_period The time between samples.
+   * @param seed The seed of the arrival process, the same seed gives the same bursts.
+   * @param rate The mean number of bursts per second.
+   * @param duration The length of each burst in seconds.
+   * @param high The voltage during a burst.
+   * @param low The voltage between bursts.
+   */
+  burst_source(std::chrono::nanoseconds const &sample_period,
+      uint64_t seed,
+      double rate,
+      double duration,
+      double high,
+      double low);
+
+protected:
+  double energy_until(double time) const override;
+
+  void discard_until(double time) override;
+
+private:
+  double duration;
+  double high;
+  double low;
+
+  // bursts are drawn as time moves forward
+  mutable std::mt19937_64 generator;
+  mutable std::exponential_distribution<double> gap;
+
+  // the integral up to the end of the last burst that was passed, and the bursts after it
+  mutable double base_time;
+  mutable double base_energy;
+  mutable std::deque<double> burst_starts;
+};
+
+/**
+ * Create a synthetic source from a description.
+ *
+ * The description is the kind of source, a colon, and its comma-separated parameters:
+ * constant:V, square:LOW,HIGH,PERIOD,DUTY, sine:OFFSET,AMPLITUDE,PERIOD,
+ * pwl:T0=V0,T1=V1,..., or bursts:SEED,RATE,DURATION,HIGH,LOW. Times are in seconds.
+ *
+ * @param description The description of the source.
+ * @param sample_period The time between samples.
+ *
+ * @return The source.
+ */
+std::unique_ptr<power_source> make_synthetic_source(std::string const &description,
+    std::chrono::nanoseconds const &sample_period);
+}
+
+#endif //EH_SIM_SYNTHETIC_SOURCE_HPP
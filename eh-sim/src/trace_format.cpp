@@ -0,0 +1,300 @@
+#include "trace_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace ehsim {
+
+namespace {
+
+constexpr char TRACE_MAGIC[8] = {'E', 'H', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+// keeps the samples and the cumulative energy column aligned for direct access
+constexpr uint64_t TRACE_ALIGNMENT = 64;
+
+uint64_t align(uint64_t offset)
+{
+  return (offset + TRACE_ALIGNMENT - 1) / TRACE_ALIGNMENT * TRACE_ALIGNMENT;
+}
+
+void write(std::FILE *fd, void const *data, size_t size)
+{
+  if(std::fwrite(data, 1, size, fd) != size) {
+    throw std::runtime_error("Could not write to voltage trace.");
+  }
+}
+
+void write_padding(std::FILE *fd, uint64_t offset)
+{
+  char const zeros[TRACE_ALIGNMENT] = {};
+  write(fd, zeros, align(offset) - offset);
+}
+
+void validate_compressed_trace(binary_trace_header const &header, void const *data, size_t size)
+{
+  if(header.samples_offset + sizeof(compressed_trace_index) > size) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+
+  auto const base = static_cast<char const *>(data);
+  auto const &index =
+      *reinterpret_cast<compressed_trace_index const *>(base + header.samples_offset);
+  if(index.block_size == 0
+      || index.block_count != (header.sample_count + index.block_size - 1) / index.block_size) {
+    throw std::runtime_error("Compressed voltage trace is corrupt.");
+  }
+
+  auto const blocks_offset = header.samples_offset + sizeof(index);
+  if(blocks_offset + index.block_count * sizeof(compressed_trace_block) > size) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+
+  auto const blocks = reinterpret_cast<compressed_trace_block const *>(base + blocks_offset);
+  for(uint64_t b = 0; b < index.block_count; ++b) {
+    if(blocks[b].offset + blocks[b].size > size) {
+      throw std::runtime_error("Voltage trace is truncated.");
+    }
+  }
+}
+}
+
+bool is_binary_trace(std::string const &path_to_trace)
+{
+  std::ifstream trace(path_to_trace, std::ios::binary);
+
+  char magic[sizeof(TRACE_MAGIC)] = {};
+  trace.read(magic, sizeof(magic));
+
+  return trace.good() && std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+size_t trace_sample_size(trace_sample_format format)
+{
+  return format == trace_sample_format::float32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+void validate_binary_trace_header(binary_trace_header const &header)
+{
+  if(std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+    throw std::runtime_error("Not a binary voltage trace.");
+  }
+
+  // the version reads byte-swapped if the trace was written with the other byte order
+  auto const swapped_version = ((TRACE_VERSION & 0xFFu) << 24) | ((TRACE_VERSION & 0xFF00u) << 8)
+                               | ((TRACE_VERSION >> 8) & 0xFF00u) | (TRACE_VERSION >> 24);
+  if(header.version == swapped_version) {
+    throw std::runtime_error("Voltage trace was written with a different byte order.");
+  }
+
+  if(header.version != TRACE_VERSION) {
+    throw std::runtime_error("Unsupported binary voltage trace version.");
+  }
+
+  if(header.sample_format != static_cast<uint32_t>(trace_sample_format::float32)
+      && header.sample_format != static_cast<uint32_t>(trace_sample_format::fixed16)
+      && header.sample_format != static_cast<uint32_t>(trace_sample_format::compressed16)) {
+    throw std::runtime_error("Unknown sample format in voltage trace.");
+  }
+
+  if(header.sample_count == 0 || header.sample_period_ns == 0) {
+    throw std::runtime_error("Voltage trace has no samples.");
+  }
+}
+
+binary_trace_header const &read_binary_trace_header(void const *data, size_t size)
+{
+  if(size < sizeof(binary_trace_header)) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+
+  auto const &header = *static_cast<binary_trace_header const *>(data);
+  validate_binary_trace_header(header);
+
+  auto const format = static_cast<trace_sample_format>(header.sample_format);
+  if(format == trace_sample_format::compressed16) {
+    validate_compressed_trace(header, data, size);
+  } else if(header.samples_offset + header.sample_count * trace_sample_size(format) > size) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+
+  if(header.cumulative_offset != 0
+      && header.cumulative_offset + (header.sample_count + 1) * sizeof(double) > size) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+
+  return header;
+}
+
+std::vector<double> read_text_trace(std::string const &path_to_trace)
+{
+  std::ifstream trace(path_to_trace);
+
+  std::vector<double> voltages;
+
+  uint64_t raw_time;
+  double voltage;
+  while(trace >> raw_time >> voltage) {
+    voltages.emplace_back(voltage);
+  }
+
+  return voltages;
+}
+
+void decode_trace_block(void const *data,
+    compressed_trace_block const &block,
+    uint64_t samples,
+    double scale,
+    std::vector<double> *voltages)
+{
+  auto byte = static_cast<uint8_t const *>(data) + block.offset;
+  auto const end = byte + block.size;
+
+  voltages->clear();
+
+  int32_t value = 0;
+  for(uint64_t i = 0; i < samples; ++i) {
+    uint32_t coded = 0;
+    for(int shift = 0;; shift += 7) {
+      if(byte == end || shift > 14) {
+        throw std::runtime_error("Compressed voltage trace is corrupt.");
+      }
+
+      coded |= static_cast<uint32_t>(*byte & 0x7F) << shift;
+      if((*byte++ & 0x80) == 0) {
+        break;
+      }
+    }
+
+    // undo the zigzag coding of the delta
+    value += static_cast<int32_t>(coded >> 1) ^ -static_cast<int32_t>(coded & 1);
+    voltages->push_back(value * scale);
+  }
+}
+
+void write_binary_trace(std::string const &path_to_trace,
+    std::vector<double> const &voltages,
+    uint64_t sample_period_ns,
+    trace_sample_format format,
+    bool with_cumulative_energy,
+    uint32_t block_size)
+{
+  if(voltages.empty()) {
+    throw std::runtime_error("Cannot write a voltage trace without samples.");
+  }
+
+  if(block_size == 0) {
+    throw std::runtime_error("Compressed voltage trace blocks need at least one sample.");
+  }
+
+  binary_trace_header header{};
+  std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.sample_format = static_cast<uint32_t>(format);
+  header.sample_period_ns = sample_period_ns;
+  header.sample_count = voltages.size();
+  header.samples_offset = align(sizeof(header));
+
+  // spread the 16-bit range over the largest voltage in the trace
+  auto const maximum_voltage = *std::max_element(voltages.begin(), voltages.end());
+  header.scale = (maximum_voltage > 0 ? maximum_voltage : 1.0) / UINT16_MAX;
+
+  auto const period = sample_period_ns * 1e-9;
+
+  // the energy uses the stored samples, so it matches what the simulator reads
+  std::vector<double> stored(voltages.size());
+  std::vector<uint8_t> payload;
+  if(format == trace_sample_format::float32) {
+    std::vector<float> samples(voltages.begin(), voltages.end());
+    std::copy(samples.begin(), samples.end(), stored.begin());
+
+    auto const bytes = reinterpret_cast<uint8_t const *>(samples.data());
+    payload.assign(bytes, bytes + samples.size() * sizeof(float));
+  } else {
+    std::vector<uint16_t> samples(voltages.size());
+    for(size_t i = 0; i < voltages.size(); ++i) {
+      auto const step = std::round(std::max(voltages[i], 0.0) / header.scale);
+      samples[i] = static_cast<uint16_t>(std::min(step, static_cast<double>(UINT16_MAX)));
+      stored[i] = samples[i] * header.scale;
+    }
+
+    if(format == trace_sample_format::fixed16) {
+      auto const bytes = reinterpret_cast<uint8_t const *>(samples.data());
+      payload.assign(bytes, bytes + samples.size() * sizeof(uint16_t));
+    } else {
+      compressed_trace_index index{};
+      index.block_size = block_size;
+      index.block_count = (samples.size() + block_size - 1) / block_size;
+
+      std::vector<compressed_trace_block> blocks(index.block_count);
+      auto const data_offset =
+          header.samples_offset + sizeof(index) + blocks.size() * sizeof(compressed_trace_block);
+
+      std::vector<uint8_t> coded;
+      for(size_t b = 0; b < blocks.size(); ++b) {
+        blocks[b].offset = data_offset + coded.size();
+
+        int32_t previous = 0;
+        for(size_t i = b * block_size; i < std::min(samples.size(), (b + 1) * block_size); ++i) {
+          auto const delta = static_cast<int32_t>(samples[i]) - previous;
+          previous = samples[i];
+
+          // zigzag coding keeps small negative deltas small
+          auto zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+          while(zigzag >= 0x80) {
+            coded.push_back(static_cast<uint8_t>(zigzag | 0x80));
+            zigzag >>= 7;
+          }
+          coded.push_back(static_cast<uint8_t>(zigzag));
+
+          blocks[b].energy += stored[i] * period;
+        }
+
+        blocks[b].size = data_offset + coded.size() - blocks[b].offset;
+      }
+
+      auto const index_bytes = reinterpret_cast<uint8_t const *>(&index);
+      auto const block_bytes = reinterpret_cast<uint8_t const *>(blocks.data());
+      payload.assign(index_bytes, index_bytes + sizeof(index));
+      payload.insert(payload.end(), block_bytes,
+          block_bytes + blocks.size() * sizeof(compressed_trace_block));
+      payload.insert(payload.end(), coded.begin(), coded.end());
+    }
+  }
+
+  auto const samples_end = header.samples_offset + payload.size();
+  header.cumulative_offset = with_cumulative_energy ? align(samples_end) : 0;
+
+  std::FILE *fd = std::fopen(path_to_trace.c_str(), "wb");
+  if(fd == nullptr) {
+    throw std::runtime_error("Could not open voltage trace: " + path_to_trace);
+  }
+
+  try {
+    write(fd, &header, sizeof(header));
+    write_padding(fd, sizeof(header));
+    write(fd, payload.data(), payload.size());
+
+    if(with_cumulative_energy) {
+      write_padding(fd, samples_end);
+
+      std::vector<double> cumulative(stored.size() + 1, 0.0);
+      for(size_t i = 0; i < stored.size(); ++i) {
+        cumulative[i + 1] = cumulative[i] + stored[i] * period;
+      }
+      write(fd, cumulative.data(), cumulative.size() * sizeof(double));
+    }
+  } catch(...) {
+    std::fclose(fd);
+    throw;
+  }
+
+  if(std::fclose(fd) != 0) {
+    throw std::runtime_error("Could not write to voltage trace.");
+  }
+}
+}
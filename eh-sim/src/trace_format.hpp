@@ -0,0 +1,140 @@
+#ifndef EH_SIM_TRACE_FORMAT_HPP
+#define EH_SIM_TRACE_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ehsim {
+
+/**
+ * The encoding of the samples in a binary voltage trace.
+ */
+enum class trace_sample_format : uint32_t {
+  /**
+   * Each sample is a 32-bit float in volts.
+   */
+  float32 = 0,
+
+  /**
+   * Each sample is an unsigned 16-bit integer, multiplied by the header's scale to get volts.
+   */
+  fixed16 = 1,
+
+  /**
+   * Samples are quantized like fixed16, then delta and zigzag-varint coded in blocks.
+   *
+   * A compressed_trace_index and its blocks' entries start at samples_offset.
+   */
+  compressed16 = 2
+};
+
+/**
+ * The header at the start of a binary voltage trace.
+ *
+ * The packed samples start at samples_offset. If cumulative_offset is not zero, it points to
+ * sample_count + 1 doubles holding the cumulative energy of the trace: entry k is the integral of
+ * the voltage over the first k samples, in volt-seconds.
+ *
+ * All values are in the byte order of the host that wrote the trace, so the file can be mapped into
+ * memory and read in place. Traces written on a host with the other byte order are rejected.
+ */
+struct binary_trace_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t sample_format;
+  uint64_t sample_period_ns;
+  uint64_t sample_count;
+  double scale;
+  uint64_t samples_offset;
+  uint64_t cumulative_offset;
+};
+
+/**
+ * The block index of a compressed voltage trace.
+ *
+ * Every block holds block_size samples, except for the last one. The first sample of a block is
+ * coded relative to zero, so each block can be decompressed on its own.
+ */
+struct compressed_trace_index {
+  uint32_t block_size;
+  uint32_t reserved;
+  uint64_t block_count;
+};
+
+/**
+ * An entry in the block index of a compressed voltage trace.
+ */
+struct compressed_trace_block {
+  // where the block's coded samples start in the file, and their size in bytes
+  uint64_t offset;
+  uint64_t size;
+  // the integral of the voltage over the block, in volt-seconds
+  double energy;
+};
+
+/**
+ * @return true if the file starts with the magic number of a binary voltage trace.
+ */
+bool is_binary_trace(std::string const &path_to_trace);
+
+/**
+ * Check the fields of a binary voltage trace's header.
+ */
+void validate_binary_trace_header(binary_trace_header const &header);
+
+/**
+ * @return The size in bytes of one sample in the given format.
+ */
+size_t trace_sample_size(trace_sample_format format);
+
+/**
+ * Check the header of a binary voltage trace that was loaded into memory.
+ *
+ * @param data The contents of the trace file.
+ * @param size The size of the trace file in bytes.
+ *
+ * @return The header of the trace.
+ */
+binary_trace_header const &read_binary_trace_header(void const *data, size_t size);
+
+/**
+ * Decompress a block of a compressed voltage trace.
+ *
+ * @param data The contents of the trace file.
+ * @param block The block's entry in the index.
+ * @param samples The number of samples in the block.
+ * @param scale The volts per step of the quantized samples.
+ * @param voltages Where to put the voltages, replacing its contents.
+ */
+void decode_trace_block(void const *data,
+    compressed_trace_block const &block,
+    uint64_t samples,
+    double scale,
+    std::vector<double> *voltages);
+
+/**
+ * Read the voltages of a text trace, where every line holds a time stamp and a voltage.
+ */
+std::vector<double> read_text_trace(std::string const &path_to_trace);
+
+/**
+ * Write a binary voltage trace.
+ *
+ * @param path_to_trace The file to write.
+ * @param voltages The voltage samples, in volts.
+ * @param sample_period_ns The time between samples in nanoseconds.
+ * @param format The encoding of the samples.
+ * @param with_cumulative_energy true to add the cumulative energy column.
+ * @param block_size The number of samples per block of a compressed trace.
+ */
+void write_binary_trace(std::string const &path_to_trace,
+    std::vector<double> const &voltages,
+    uint64_t sample_period_ns,
+    trace_sample_format format,
+    bool with_cumulative_energy,
+    uint32_t block_size = 4096);
+}
+
+#endif //EH_SIM_TRACE_FORMAT_HPP
@@ -0,0 +1,198 @@
+#include "trace_stream.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+
+namespace ehsim {
+
+trace_stream::trace_stream(std::string const &path_to_trace,
+    std::chrono::nanoseconds const &sample_period,
+    size_t block_size)
+    : input(nullptr)
+    , from_stdin(path_to_trace == "-")
+    , seekable(false)
+    , period(sample_period)
+    , binary(false)
+    , header{}
+    , samples_left(0)
+    , position(0)
+    , next_ready(false)
+    , stop(false)
+{
+  input = from_stdin ? stdin : std::fopen(path_to_trace.c_str(), "rb");
+  if(input == nullptr) {
+    throw std::runtime_error("Could not open voltage trace: " + path_to_trace);
+  }
+
+  try {
+    seekable = std::fseek(input, 0, SEEK_CUR) == 0;
+
+    // binary traces start with a magic number, text traces with a time stamp
+    auto const first = std::getc(input);
+    binary = first == 'E';
+    std::ungetc(first, input);
+
+    start();
+
+    period = binary ? std::chrono::nanoseconds(header.sample_period_ns) : period;
+    if(period.count() == 0) {
+      throw std::runtime_error("No sampling rate provided for the voltage trace.");
+    }
+
+    current.reserve(block_size);
+    ahead.reserve(block_size);
+    fill(current);
+    if(current.empty()) {
+      throw std::runtime_error("Voltage trace has no samples: " + path_to_trace);
+    }
+  } catch(...) {
+    if(!from_stdin) {
+      std::fclose(input);
+    }
+    throw;
+  }
+
+  reader = std::thread(&trace_stream::read_ahead, this);
+}
+
+trace_stream::~trace_stream()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stop = true;
+  }
+  next_changed.notify_all();
+  reader.join();
+
+  if(!from_stdin) {
+    std::fclose(input);
+  }
+}
+
+void trace_stream::start()
+{
+  if(!binary) {
+    return;
+  }
+
+  if(std::fread(&header, sizeof(header), 1, input) != 1) {
+    throw std::runtime_error("Voltage trace is truncated.");
+  }
+  validate_binary_trace_header(header);
+
+  if(header.sample_format == static_cast<uint32_t>(trace_sample_format::compressed16)) {
+    throw std::runtime_error("Compressed voltage traces cannot be streamed.");
+  }
+
+  // pipes cannot seek, so skip the padding by reading it
+  for(auto offset = sizeof(header); offset < header.samples_offset; ++offset) {
+    if(std::getc(input) == EOF) {
+      throw std::runtime_error("Voltage trace is truncated.");
+    }
+  }
+
+  samples_left = header.sample_count;
+}
+
+void trace_stream::fill(std::vector<double> &block)
+{
+  block.clear();
+
+  // stop at an empty trace instead of wrapping around forever
+  auto size_at_last_wrap = SIZE_MAX;
+
+  while(block.size() < block.capacity()) {
+    auto const wanted = block.capacity() - block.size();
+
+    if(binary) {
+      auto const format = static_cast<trace_sample_format>(header.sample_format);
+      auto const size = trace_sample_size(format);
+      auto const count = static_cast<size_t>(std::min<uint64_t>(wanted, samples_left));
+
+      raw.resize(count * size);
+      auto const read = std::fread(raw.data(), size, count, input);
+      samples_left -= read;
+
+      for(size_t i = 0; i < read; ++i) {
+        if(format == trace_sample_format::float32) {
+          float value;
+          std::memcpy(&value, &raw[i * size], sizeof(value));
+          block.push_back(value);
+        } else {
+          uint16_t value;
+          std::memcpy(&value, &raw[i * size], sizeof(value));
+          block.push_back(value * header.scale);
+        }
+      }
+
+      if(read == count && samples_left > 0) {
+        continue;
+      }
+    } else {
+      uint64_t raw_time;
+      double voltage;
+      while(block.size() < block.capacity()
+            && std::fscanf(input, "%" SCNu64 " %lf", &raw_time, &voltage) == 2) {
+        block.push_back(voltage);
+      }
+
+      if(block.size() == block.capacity()) {
+        break;
+      }
+    }
+
+    // reached the end of the trace, wrap around if possible
+    if(!seekable || block.size() == size_at_last_wrap || std::fseek(input, 0, SEEK_SET) != 0) {
+      break;
+    }
+    size_at_last_wrap = block.size();
+    start();
+  }
+}
+
+void trace_stream::read_ahead()
+{
+  std::unique_lock<std::mutex> guard(lock);
+
+  while(true) {
+    next_changed.wait(guard, [this]() { return stop || !next_ready; });
+    if(stop) {
+      return;
+    }
+
+    // the simulator does not touch the next block until it is ready
+    guard.unlock();
+    try {
+      fill(ahead);
+    } catch(...) {
+      error = std::current_exception();
+    }
+    guard.lock();
+
+    next_ready = true;
+    next_changed.notify_all();
+  }
+}
+
+void trace_stream::advance()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  next_changed.wait(guard, [this]() { return next_ready; });
+
+  if(error) {
+    std::rethrow_exception(error);
+  }
+
+  if(ahead.empty()) {
+    throw std::runtime_error("Voltage trace ended before the simulation.");
+  }
+
+  std::swap(current, ahead);
+  position = 0;
+
+  next_ready = false;
+  next_changed.notify_all();
+}
+}
@@ -0,0 +1,95 @@
+#ifndef EH_SIM_TRACE_STREAM_HPP
+#define EH_SIM_TRACE_STREAM_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "trace_format.hpp"
+
+namespace ehsim {
+
+/**
+ * Reads a voltage trace forward, one block of samples at a time.
+ *
+ * A background thread reads the next block while the simulator uses the current one, so memory
+ * use does not depend on the length of the trace. Regular files wrap around at their end, while
+ * pipes (including stdin) cannot and end the trace.
+ */
+class trace_stream {
+public:
+  /**
+   * Constructor.
+   *
+   * @param path_to_trace Path to a text or binary trace, or "-" to read from stdin.
+   * @param sample_period The time between samples in a text trace, ignored for binary traces.
+   * @param block_size The number of samples in each of the two buffers.
+   */
+  trace_stream(std::string const &path_to_trace,
+      std::chrono::nanoseconds const &sample_period,
+      size_t block_size = 1 << 16);
+
+  ~trace_stream();
+
+  trace_stream(trace_stream const &) = delete;
+  trace_stream &operator=(trace_stream const &) = delete;
+
+  /**
+   * @return The voltage of the next sample in the trace.
+   */
+  double next()
+  {
+    if(position == current.size()) {
+      advance();
+    }
+
+    return current[position++];
+  }
+
+  std::chrono::nanoseconds sample_period() const
+  {
+    return period;
+  }
+
+private:
+  std::FILE *input;
+  bool from_stdin;
+  bool seekable;
+  std::chrono::nanoseconds period;
+
+  // binary traces only
+  bool binary;
+  binary_trace_header header;
+  uint64_t samples_left;
+
+  // the block in use by the simulator
+  std::vector<double> current;
+  size_t position;
+
+  // the block being read ahead
+  std::vector<double> ahead;
+  std::vector<char> raw;
+  bool next_ready;
+  bool stop;
+  std::exception_ptr error;
+  std::mutex lock;
+  std::condition_variable next_changed;
+  std::thread reader;
+
+  void start();
+
+  void fill(std::vector<double> &block);
+
+  void read_ahead();
+
+  void advance();
+};
+}
+
+#endif //EH_SIM_TRACE_STREAM_HPP
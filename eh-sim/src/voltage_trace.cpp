@@ -1,32 +1,228 @@
 #include "voltage_trace.hpp"
 
-#include <fstream>
+#include "mapped_file.hpp"
+#include "trace_stream.hpp"
+
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 namespace ehsim {
-voltage_trace::voltage_trace(std::string const &path_to_trace, std::chrono::milliseconds const &sample_period)
-  : maximum_time(0), period(sample_period)
+
+namespace {
+
+// how far the cursor may skip at once in a trace with a cumulative energy column
+constexpr uint64_t CUMULATIVE_SKIP_SPAN = 4096;
+}
+
+voltage_trace::voltage_trace(std::string const &path_to_trace,
+    std::chrono::nanoseconds const &sample_period,
+    bool streaming)
+  : period(sample_period)
+  , sample_count(0)
+  , position(0)
+  , current_voltage(0)
+  , voltage_loaded(false)
+  , format(trace_sample_format::float32)
+  , samples(nullptr)
+  , scale(1.0)
+  , cumulative(nullptr)
+  , block_index(nullptr)
+  , blocks(nullptr)
+  , next_victim(0)
+  , current_block(nullptr)
+  , block(0)
+  , block_length(0)
+  , offset_in_block(0)
 {
-  std::ifstream trace(path_to_trace);
+  if(streaming || path_to_trace == "-") {
+    stream = std::make_unique<trace_stream>(path_to_trace, period);
+    set_period(stream->sample_period());
+    current_voltage = stream->next();
+    voltage_loaded = true;
 
-  uint64_t raw_time;
-  double voltage;
-  if(trace >> raw_time >> voltage) {
-    voltages.emplace_back(voltage);
+    std::cout << "streaming voltage trace\n";
+    return;
+  }
 
-    while(trace >> raw_time >> voltage) {
-      voltages.emplace_back(voltage);
+  if(is_binary_trace(path_to_trace)) {
+    load_binary(path_to_trace);
+  } else {
+    if(period.count() == 0) {
+      throw std::runtime_error("No sampling rate provided for the voltage trace.");
     }
 
-    maximum_time = std::chrono::milliseconds(voltages.size());
-    std::cout << "maximum_time: " << maximum_time.count() << "\n";
+    voltages = read_text_trace(path_to_trace);
+    sample_count = voltages.size();
+  }
+
+  if(sample_count == 0) {
+    throw std::runtime_error("Voltage trace has no samples: " + path_to_trace);
   }
+
+  load_voltage();
+
+  std::cout << "voltage trace samples: " << sample_count << "\n";
 }
 
-double voltage_trace::get_voltage(std::chrono::milliseconds const &time) const
+voltage_trace::~voltage_trace() = default;
+
+void voltage_trace::load_binary(std::string const &path_to_trace)
 {
+  mapping = std::make_unique<mapped_file>(path_to_trace);
+
+  auto const base = static_cast<char const *>(mapping->data());
+  auto const &header = read_binary_trace_header(base, mapping->size());
+
+  set_period(std::chrono::nanoseconds(header.sample_period_ns));
+  sample_count = header.sample_count;
+
+  format = static_cast<trace_sample_format>(header.sample_format);
+  samples = base + header.samples_offset;
+  scale = header.scale;
+
+  if(header.cumulative_offset != 0) {
+    cumulative = reinterpret_cast<double const *>(base + header.cumulative_offset);
+  }
+
+  if(format == trace_sample_format::compressed16) {
+    block_index = static_cast<compressed_trace_index const *>(samples);
+    blocks = reinterpret_cast<compressed_trace_block const *>(block_index + 1);
+
+    for(auto &entry : cache) {
+      entry.block = UINT64_MAX;
+      entry.voltages.reserve(block_index->block_size);
+    }
+
+    move_to_block(0);
+  }
+}
+
+void voltage_trace::set_period(std::chrono::nanoseconds const &trace_period)
+{
+  if(period.count() != 0 && period != trace_period) {
+    throw std::runtime_error("Sampling rate does not match the binary voltage trace.");
+  }
+
+  period = trace_period;
+}
+
+void voltage_trace::advance()
+{
+  if(stream != nullptr) {
+    // the stream wraps around by itself, as far as the input allows
+    current_voltage = stream->next();
+    return;
+  }
+
   // this wraps around the voltage trace
-  auto const index = (time.count() / period.count()) % maximum_time.count();
-  return voltages[index];
+  if(blocks != nullptr) {
+    if(++offset_in_block == block_length) {
+      move_to_block(block + 1 == block_index->block_count ? 0 : block + 1);
+    }
+  } else if(++position == sample_count) {
+    position = 0;
+  }
+
+  load_voltage();
+}
+
+uint64_t voltage_trace::skippable_samples() const
+{
+  if(blocks != nullptr) {
+    // only whole blocks have a precomputed energy
+    return offset_in_block == 0 ? block_length : 0;
+  }
+
+  if(cumulative != nullptr) {
+    return std::min(sample_count - position, CUMULATIVE_SKIP_SPAN);
+  }
+
+  return 0;
+}
+
+double voltage_trace::skippable_energy() const
+{
+  if(blocks != nullptr) {
+    return blocks[block].energy;
+  }
+
+  return cumulative[position + skippable_samples()] - cumulative[position];
+}
+
+void voltage_trace::skip()
+{
+  if(blocks != nullptr) {
+    move_to_block(block + 1 == block_index->block_count ? 0 : block + 1);
+  } else {
+    position += skippable_samples();
+    if(position == sample_count) {
+      position = 0;
+    }
+  }
+
+  // the next sample is read only if it is used
+  voltage_loaded = false;
+}
+
+double voltage_trace::read_sample(uint64_t index) const
+{
+  if(mapping == nullptr) {
+    return voltages[index];
+  }
+
+  if(format == trace_sample_format::float32) {
+    return static_cast<float const *>(samples)[index];
+  }
+
+  return static_cast<uint16_t const *>(samples)[index] * scale;
+}
+
+void voltage_trace::load_voltage() const
+{
+  if(blocks != nullptr) {
+    if(current_block == nullptr) {
+      current_block = decode_block(block);
+    }
+
+    current_voltage = (*current_block)[offset_in_block];
+  } else {
+    current_voltage = read_sample(position);
+  }
+
+  voltage_loaded = true;
+}
+
+void voltage_trace::move_to_block(uint64_t index)
+{
+  block = index;
+  offset_in_block = 0;
+  current_block = nullptr;
+
+  // every block is full, except for the last one
+  auto const last = block_index->block_count - 1;
+  block_length = block == last ? sample_count - last * block_index->block_size
+                               : block_index->block_size;
+}
+
+std::vector<double> const *voltage_trace::decode_block(uint64_t index) const
+{
+  for(auto const &entry : cache) {
+    if(entry.block == index) {
+      return &entry.voltages;
+    }
+  }
+
+  auto &victim = cache[next_victim];
+  next_victim = (next_victim + 1) % cache.size();
+
+  victim.block = UINT64_MAX;
+  decode_trace_block(mapping->data(), blocks[index],
+      index + 1 == block_index->block_count ? sample_count - index * block_index->block_size
+                                            : block_index->block_size,
+      scale, &victim.voltages);
+  victim.block = index;
+
+  return &victim.voltages;
 }
 }
@@ -1,41 +1,137 @@
 #ifndef EH_SIM_VOLTAGE_TRACE_HPP
 #define EH_SIM_VOLTAGE_TRACE_HPP
 
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "power_source.hpp"
+#include "trace_format.hpp"
+
 namespace ehsim {
-class voltage_trace {
+
+class mapped_file;
+class trace_stream;
+
+/**
+ * A voltage trace.
+ *
+ * The cursor starts at the first sample and wraps around at the end of the trace. Only traces
+ * with precomputed energy can skip samples.
+ */
+class voltage_trace : public power_source {
 public:
   /**
    * Constructor.
    *
-   * @param path_to_trace Path to an existing and valid trace file.
-   * @param sample_period The time between samples in the trace.
+   * Binary traces are memory-mapped and take their sample period from the file. Streamed traces
+   * are read forward through a small window instead of being loaded.
+   *
+   * @param path_to_trace Path to an existing and valid trace file, in text or binary format, or
+   * "-" to stream the trace from stdin.
+   * @param sample_period The time between samples in a text trace, zero to use the binary trace's.
+   * @param streaming true to stream the trace.
    */
-  voltage_trace(std::string const &path_to_trace, std::chrono::milliseconds const &sample_period);
+  voltage_trace(std::string const &path_to_trace,
+      std::chrono::nanoseconds const &sample_period,
+      bool streaming = false);
+
+  ~voltage_trace() override;
+
+  double voltage() const override
+  {
+    if(!voltage_loaded) {
+      load_voltage();
+    }
+
+    return current_voltage;
+  }
+
+  void advance() override;
+
+  std::chrono::nanoseconds sample_period() const override
+  {
+    return period;
+  }
+
+  uint64_t skippable_samples() const override;
+
+  double skippable_energy() const override;
+
+  void skip() override;
 
   /**
-   * Get the voltage at the specified time.
+   * @return true if the trace has a precomputed cumulative energy column.
+   */
+  bool has_cumulative_energy() const
+  {
+    return cumulative != nullptr;
+  }
+
+  /**
+   * Get the integral of the voltage over the first samples of the trace.
    *
-   * @param time The time in microseconds.
+   * @param samples The number of samples, at most the length of the trace.
    *
-   * @return The voltage reading at the specified time.
+   * @return The integral in volt-seconds.
    */
-  double get_voltage(std::chrono::milliseconds const &time) const;
-
-  std::chrono::milliseconds sample_period() const
+  double cumulative_energy(size_t samples) const
   {
-    return period;
+    return cumulative[samples];
   }
 
 private:
-  std::chrono::milliseconds period;
+  std::chrono::nanoseconds period;
+
+  uint64_t sample_count;
 
-  std::chrono::milliseconds maximum_time;
+  // the cursor, which reads its sample lazily after a skip
+  uint64_t position;
+  mutable double current_voltage;
+  mutable bool voltage_loaded;
 
+  // text traces are parsed into memory
   std::vector<double> voltages;
+
+  // streamed traces keep only a window of samples in memory
+  std::unique_ptr<trace_stream> stream;
+
+  // binary traces are read directly from the mapped file
+  std::unique_ptr<mapped_file> mapping;
+  trace_sample_format format;
+  void const *samples;
+  double scale;
+  double const *cumulative;
+
+  // compressed traces decode blocks on demand into a small cache
+  struct cached_block {
+    uint64_t block;
+    std::vector<double> voltages;
+  };
+
+  compressed_trace_index const *block_index;
+  compressed_trace_block const *blocks;
+  mutable std::array<cached_block, 4> cache;
+  mutable size_t next_victim;
+  mutable std::vector<double> const *current_block;
+  uint64_t block;
+  uint64_t block_length;
+  uint64_t offset_in_block;
+
+  void load_binary(std::string const &path_to_trace);
+
+  void set_period(std::chrono::nanoseconds const &trace_period);
+
+  double read_sample(uint64_t index) const;
+
+  void load_voltage() const;
+
+  void move_to_block(uint64_t index);
+
+  std::vector<double> const *decode_block(uint64_t index) const;
 };
 }
 
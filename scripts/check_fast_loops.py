@@ -0,0 +1,103 @@
+import argparse
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+# a run charges its energy at once, and the rounding can move a power-on across a sample of the trace
+TIME_TOLERANCE = 1e-4
+
+
+def run(eh_sim, app, source, scheme, fast_loops, out_dir):
+    base_name = scheme + ("-fast" if fast_loops else "-interpreted")
+    path_to_output = out_dir + "/" + base_name + ".csv"
+
+    to_run = [eh_sim, "-b" + app, "--source=" + source, "--scheme=" + scheme, "-o" + path_to_output]
+    if fast_loops:
+        to_run.append("--fast-loops")
+
+    result = subprocess.run(to_run, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    output = result.stdout
+    if os.path.exists(path_to_output):
+        with open(path_to_output) as f:
+            output += f.read()
+        os.remove(path_to_output)
+
+    return output
+
+
+def last_digit(field):
+    """The value of one unit in the last printed digit of a real."""
+    mantissa, _, exponent = field.lower().partition('e')
+    return 10.0 ** (int(exponent or 0) - len(mantissa.partition('.')[2]))
+
+
+def same_field(interpreted, fast):
+    if interpreted == fast:
+        return True
+
+    # energy is harvested and consumed in larger steps, so reals may differ in their last printed digit
+    try:
+        a = float(interpreted)
+        b = float(fast)
+    except ValueError:
+        return False
+
+    if '.' not in interpreted or '.' not in fast:
+        return False
+
+    return abs(a - b) <= 1.5 * max(last_digit(interpreted), last_digit(fast))
+
+
+def compare(interpreted, fast):
+    """The first line that differs, or None if the outputs match."""
+    interpreted_lines = interpreted.splitlines()
+    fast_lines = fast.splitlines()
+    if len(interpreted_lines) != len(fast_lines):
+        return "{} lines interpreted, {} lines with --fast-loops".format(len(interpreted_lines), len(fast_lines))
+
+    for a, b in zip(interpreted_lines, fast_lines):
+        if a.startswith("Total time") and b.startswith("Total time"):
+            a_time = int(a.split()[-1])
+            b_time = int(b.split()[-1])
+            if abs(a_time - b_time) <= TIME_TOLERANCE * a_time:
+                continue
+
+        a_fields = a.replace(',', ' ').split()
+        b_fields = b.replace(',', ' ').split()
+        if len(a_fields) != len(b_fields) or not all(same_field(x, y) for x, y in zip(a_fields, b_fields)):
+            return "interpreted: {}\n--fast-loops: {}".format(a, b)
+
+    return None
+
+
+if __name__ == "__main__":
+    p = argparse.ArgumentParser(description='Check that eh-sim gives the same results with --fast-loops.')
+    p.add_argument('-x', '--exe', dest='eh_sim', default=None)
+    p.add_argument('--source', dest='source', default='constant:3.0')
+    p.add_argument('--schemes', dest='schemes', default='clank,parametric,undo-log,mementos,hibernus,oracle')
+    p.add_argument('apps', nargs='*')
+
+    (args) = p.parse_args()
+
+    if args.eh_sim is None:
+        sys.exit("Error: need path to eh-sim executable.")
+    if len(args.apps) == 0:
+        sys.exit("Error: no applications to run.")
+
+    failed = False
+    with tempfile.TemporaryDirectory() as out_dir:
+        for app in args.apps:
+            for scheme in args.schemes.split(','):
+                interpreted = run(args.eh_sim, app, args.source, scheme, False, out_dir)
+                fast = run(args.eh_sim, app, args.source, scheme, True, out_dir)
+
+                difference = compare(interpreted, fast)
+                if difference is None:
+                    print("{} with {}: same".format(os.path.basename(app), scheme))
+                else:
+                    print("{} with {}: different\n{}".format(os.path.basename(app), scheme, difference))
+                    failed = True
+
+    sys.exit(1 if failed else 0)
@@ -4,6 +4,8 @@ import os
 import csv
 import random
 
+from columnar import ColumnarFile
+
 
 def read_data_sampled(data_file, num_samples):
     with open(data_file) as csvin:
@@ -35,6 +37,29 @@ def read_data_sampled(data_file, num_samples):
         writer.writerows(samples)
 
 
+def read_columnar_data_sampled(data_file, num_samples):
+    data = ColumnarFile(data_file)
+
+    # the footer knows the number of rows, no need to parse the file twice
+    indices = sorted(random.sample(range(data.num_rows), min(num_samples, data.num_rows)))
+
+    samples = []
+    for index in indices:
+        row = data.row(index)
+        row.extend([benchmark, scheme, trace])
+        samples.append(row)
+
+    writer.writerows(samples)
+
+
+def read_columnar_data(data_file):
+    samples = ColumnarFile(data_file).rows()
+    for row in samples:
+        row.extend([benchmark, scheme, trace])
+
+    writer.writerows(samples)
+
+
 def read_data(data_file):
     with open(data_file) as csvin:
         reader = csv.reader(csvin, skipinitialspace=True)
@@ -89,6 +114,8 @@ if __name__ == "__main__":
                     scheme = ""
                     if file.endswith('.csv'):
                         scheme = file.replace('-True.csv', '')
+                    elif file.endswith('.ehc'):
+                        scheme = file.replace('-True.ehc', '')
                     else:
                         continue
 
@@ -100,7 +127,12 @@ if __name__ == "__main__":
 
                     file = os.path.join(trace_dir, file)
 
-                    if args.num_samples is None:
+                    if file.endswith('.ehc'):
+                        if args.num_samples is None:
+                            read_columnar_data(file)
+                        else:
+                            read_columnar_data_sampled(file, int(args.num_samples))
+                    elif args.num_samples is None:
                         read_data(file)
                     else:
                         read_data_sampled(file, int(args.num_samples))
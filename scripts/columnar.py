@@ -0,0 +1,68 @@
+import struct
+
+MAGIC = b'EHCOLS\0\0'
+END_MAGIC = b'EHCOLEND'
+INTEGER = 0
+REAL = 1
+
+
+class ColumnarFile:
+    """Reads the binary, columnar output of eh-sim (--output-format=columnar)."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+
+        if self.data[:8] != MAGIC or self.data[-8:] != END_MAGIC:
+            raise ValueError("{} is not a columnar file".format(path))
+
+        version, num_columns = struct.unpack_from('<II', self.data, 8)
+        if version != 1:
+            raise ValueError("unsupported columnar version {}".format(version))
+
+        self.names = []
+        self.types = []
+        offset = 16
+        for _ in range(num_columns):
+            col_type, name_length = struct.unpack_from('<BB', self.data, offset)
+            offset += 2
+            self.names.append(self.data[offset:offset + name_length].decode())
+            self.types.append(col_type)
+            offset += name_length
+
+        footer_offset, = struct.unpack_from('<Q', self.data, len(self.data) - 16)
+        num_chunks, = struct.unpack_from('<Q', self.data, footer_offset)
+        self.chunks = [struct.unpack_from('<QQ', self.data, footer_offset + 8 + 16 * i) for i in range(num_chunks)]
+        self.num_rows, = struct.unpack_from('<Q', self.data, footer_offset + 8 + 16 * num_chunks)
+
+    def column(self, name):
+        """All values of one column, as a list."""
+        index = self.names.index(name)
+        code = 'q' if self.types[index] == INTEGER else 'd'
+
+        values = []
+        for chunk_offset, rows in self.chunks:
+            start = chunk_offset + index * rows * 8
+            values.extend(struct.unpack_from('<{}{}'.format(rows, code), self.data, start))
+
+        return values
+
+    def columns(self):
+        return [self.column(name) for name in self.names]
+
+    def row(self, index):
+        """The values of one row, as a list."""
+        for chunk_offset, rows in self.chunks:
+            if index < rows:
+                row = []
+                for col, col_type in enumerate(self.types):
+                    code = '<q' if col_type == INTEGER else '<d'
+                    row.append(struct.unpack_from(code, self.data, chunk_offset + (col * rows + index) * 8)[0])
+                return row
+
+            index -= rows
+
+        raise IndexError("row index out of range")
+
+    def rows(self):
+        return [list(row) for row in zip(*self.columns())]
@@ -4,8 +4,8 @@ import subprocess
 import os
 
 
-def run(eh_sim, app, trace, rate, tau_b, harvest, out_dir):
-    base_name = "parametric" + "-" + str(tau_b) + "-" + str(harvest)
+def run(eh_sim, app, trace, rate, tau_b, harvest, adaptive, out_dir):
+    base_name = "parametric" + "-" + ("adaptive" if adaptive else str(tau_b)) + "-" + str(harvest)
     path_to_output = out_dir + "/" + base_name + ".csv"
 
     to_run = "{} -b{} --voltage-trace={} --voltage-rate={} --scheme=parametric --tau-b={} -o{}".format(eh_sim, app,
@@ -19,6 +19,9 @@ def run(eh_sim, app, trace, rate, tau_b, harvest, out_dir):
     else:
         to_run.append('--always-harvest=0')
 
+    if adaptive is True:
+        to_run.append('--adaptive-tau-b')
+
     stdout_file = open(out_dir + "/" + base_name + ".stdout", "w")
     stderr_file = open(out_dir + "/" + base_name + ".stderr", "w")
     subprocess.run(to_run, stdout=stdout_file, stderr=stderr_file)
@@ -30,6 +33,8 @@ if __name__ == "__main__":
     p.add_argument('--benchmark-dir', dest='benchmark_dir', default=None)
     p.add_argument('--voltage-trace-dir', dest="vtrace_dir", default=None)
     p.add_argument('-d', '--destination', dest='output_dir', default=None)
+    p.add_argument('--adaptive', dest='adaptive', action='store_true',
+                   help='re-tune the backup period at run time instead of sweeping it')
 
     (args) = p.parse_args()
 
@@ -50,6 +55,9 @@ if __name__ == "__main__":
     vtrace_whitelist = ['6']
     # different backup periods (in cycles) to try
     backup_periods = list(range(250, 3000, 250))
+    if args.adaptive:
+        # a single run starts from the default period and re-tunes it
+        backup_periods = [1000]
 
     for vtrace in vtrace_whitelist:
         for benchmark in benchmark_whitelist:
@@ -62,4 +70,5 @@ if __name__ == "__main__":
                 path_to_destination = args.output_dir + "/" + benchmark + "/" + vtrace
                 os.makedirs(path_to_destination, exist_ok=True)
 
-                run(args.eh_sim, path_to_benchmark, path_to_vtrace, 1, bperiod, True, path_to_destination)
+                run(args.eh_sim, path_to_benchmark, path_to_vtrace, 1, bperiod, True, args.adaptive,
+                    path_to_destination)
@@ -0,0 +1,51 @@
+#ifndef THUMBULATOR_CONSOLE_HPP
+#define THUMBULATOR_CONSOLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace thumbulator {
+
+/**
+ * The address of the UART's transmit register.
+ */
+constexpr uint32_t UART_ADDRESS = 0xE0000000;
+
+/**
+ * The number of characters buffered before they are handed to the flush hook.
+ */
+constexpr size_t CONSOLE_BUFFER_SIZE = 1 << 16;
+
+/**
+ * Hook that receives the application's console output, one chunk at a time.
+ *
+ * The first parameter points to the characters.
+ * The second parameter is the number of characters.
+ *
+ * Console output is discarded if there is no hook.
+ */
+extern std::function<void(char const *, size_t)> console_flush_hook;
+
+/**
+ * Write a character to the console, as the UART and semihosting do.
+ *
+ * The character is buffered until the buffer is full or console_flush is called.
+ */
+void console_write(char character);
+
+/**
+ * Hand the buffered console output to the flush hook.
+ */
+void console_flush();
+
+/**
+ * Serve the semihosting request of a bkpt 0xAB.
+ *
+ * Writing a character (SYS_WRITEC) or a string (SYS_WRITE0) to the console is supported. Other
+ * operations fail, returning -1 in r0.
+ */
+void semihosting_call();
+}
+
+#endif //THUMBULATOR_CONSOLE_HPP
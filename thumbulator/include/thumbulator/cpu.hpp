@@ -47,6 +47,22 @@ struct cpu_state {
    * Bit mask of pending exceptions.
    */
   uint32_t exceptmask;
+
+  /**
+   * Bit mask of active exceptions.
+   */
+  uint32_t exceptactive;
+
+  /**
+   * Vector table offset.
+   */
+  uint32_t vtor;
+
+  /**
+   * System handler priorities of SVCall (shpr2), and of PendSV and SysTick (shpr3).
+   */
+  uint32_t shpr2;
+  uint32_t shpr3;
 };
 
 /**
@@ -59,6 +75,16 @@ extern bool BRANCH_WAS_TAKEN;
  */
 extern bool EXIT_INSTRUCTION_ENCOUNTERED;
 
+/**
+ * Whether the CPU sleeps in wfi or wfe, until an exception wakes it up.
+ */
+extern bool CPU_IS_SLEEPING;
+
+/**
+ * The event register, set by sev and by exception entry and return, and cleared by wfe.
+ */
+extern bool EVENT_REGISTER;
+
 /**
  * Resets the CPU according to the specification.
  */
@@ -98,8 +124,46 @@ struct system_tick {
   uint32_t calib;
 };
 
+/**
+ * The SYSTICK registers.
+ *
+ * The current value is only brought up to date when it is read, and the counter wraps in an event
+ * scheduled for the cycle it reaches zero at.
+ */
 extern system_tick SYSTICK;
 
+/**
+ * Read a SYSTICK register.
+ *
+ * @param address The address of the register.
+ */
+uint32_t systick_read(uint32_t address);
+
+/**
+ * Write a SYSTICK register.
+ *
+ * @param address The address of the register.
+ * @param value The value to write.
+ */
+void systick_write(uint32_t address, uint32_t value);
+
+/**
+ * Bring the current value of SYSTICK up to date with the cycle count.
+ */
+void systick_update();
+
+/**
+ * Continue counting down from the current value, after the registers were replaced.
+ */
+void systick_resume();
+
+/**
+ * Reload the counter when it reaches zero.
+ *
+ * @param cycle The cycle the counter reached zero at.
+ */
+void systick_wrap(uint64_t cycle);
+
 /**
  * Cycles taken for branch instructions.
  */
@@ -120,6 +184,26 @@ extern system_tick SYSTICK;
  */
 #define TIMING_MEM 2
 
+/**
+ * Cycles taken by wfi and wfe to enter sleep.
+ */
+#define TIMING_SLEEP 2
+
+/**
+ * Cycles taken for instructions that access special registers, and for barriers.
+ */
+#define TIMING_SYSTEM 3
+
+/**
+ * Cycles taken to stack the context and fetch the vector when an exception is taken.
+ */
+#define TIMING_EXCEPTION_ENTRY 16
+
+/**
+ * Cycles taken by a branch that returns from an exception and unstacks the context.
+ */
+#define TIMING_EXCEPTION_RETURN 16
+
 /**
  * Perform the execute, mem, and write-back stages.
  *
@@ -0,0 +1,67 @@
+#ifndef THUMBULATOR_EVENT_HPP
+#define THUMBULATOR_EVENT_HPP
+
+#include <cstdint>
+
+namespace thumbulator {
+
+/**
+ * The sources of events, each with at most one event scheduled at a time.
+ */
+enum class event_type : uint8_t { systick_wrap, exception, count };
+
+/**
+ * The cycles the CPU has executed.
+ */
+extern uint64_t CYCLE_COUNT;
+
+/**
+ * The cycle of the earliest scheduled event, or UINT64_MAX if there is none.
+ */
+extern uint64_t NEXT_EVENT_CYCLE;
+
+/**
+ * Schedule an event, replacing the one already scheduled for the same source.
+ *
+ * @param type The source of the event.
+ * @param cycle The cycle the event is due at.
+ */
+void schedule_event(event_type type, uint64_t cycle);
+
+/**
+ * Cancel the event scheduled for a source, if any.
+ */
+void cancel_event(event_type type);
+
+/**
+ * Cancel every scheduled event.
+ */
+void clear_events();
+
+/**
+ * Handle the events that are due, in the order of their cycles.
+ *
+ * @return The cycles the events took, such as taking an exception.
+ */
+uint32_t handle_due_events();
+
+/**
+ * Advance the cycle count, then handle the events that became due.
+ *
+ * @param cycles The cycles that were executed.
+ *
+ * @return The cycles the events took, which are also added to the cycle count.
+ */
+inline uint32_t advance_cycles(uint64_t cycles)
+{
+  CYCLE_COUNT += cycles;
+
+  if(CYCLE_COUNT >= NEXT_EVENT_CYCLE) {
+    return handle_due_events();
+  }
+
+  return 0;
+}
+}
+
+#endif //THUMBULATOR_EVENT_HPP
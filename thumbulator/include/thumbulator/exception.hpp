@@ -0,0 +1,110 @@
+#ifndef THUMBULATOR_EXCEPTION_HPP
+#define THUMBULATOR_EXCEPTION_HPP
+
+#include <cstdint>
+
+namespace thumbulator {
+
+/**
+ * The exception numbers that can be taken.
+ */
+enum exception_number : uint32_t {
+  EXCEPTION_HARD_FAULT = 3,
+  EXCEPTION_SVCALL = 11,
+  EXCEPTION_PENDSV = 14,
+  EXCEPTION_SYSTICK = 15
+};
+
+/**
+ * Make an exception pending.
+ *
+ * Pending exceptions are taken at the end of an instruction, if their priority is high enough.
+ */
+void pend_exception(exception_number number);
+
+/**
+ * Check for pending exceptions at the end of the current instruction.
+ *
+ * Call this when the execution priority drops, for example when PRIMASK is cleared.
+ */
+void check_pending_exceptions();
+
+/**
+ * Whether a pending exception has a high enough priority to be taken.
+ */
+bool exception_is_ready();
+
+/**
+ * Take the pending exception with the highest priority, if its priority is high enough.
+ *
+ * Stacks the context and branches to the handler in the vector table.
+ *
+ * @return The cycles taken, zero if no exception was taken.
+ */
+uint32_t take_pending_exception();
+
+/**
+ * Whether a branch to an address returns from an exception.
+ */
+bool is_exception_return(uint32_t address);
+
+/**
+ * Return from the active exception, unstacking the context.
+ *
+ * @param exc_return The EXC_RETURN value that was branched to.
+ *
+ * @return The cycles taken by the branch.
+ */
+uint32_t exception_return(uint32_t exc_return);
+
+/**
+ * Sleep until a pending exception has a high enough priority to wake the CPU up, as wfi does.
+ *
+ * The CPU does not sleep if such an exception is already pending.
+ */
+void wait_for_interrupt();
+
+/**
+ * Sleep like wait_for_interrupt, unless the event register is set, as wfe does.
+ *
+ * A set event register is cleared instead of sleeping.
+ */
+void wait_for_event();
+
+/**
+ * Raise SVCall, or HardFault if SVCall cannot be taken at the current priority.
+ */
+void supervisor_call();
+
+/**
+ * Read a special register, as mrs does.
+ *
+ * @param sysm The special register number.
+ */
+uint32_t read_special_register(uint32_t sysm);
+
+/**
+ * Write a special register, as msr does.
+ *
+ * @param sysm The special register number.
+ * @param value The value to write.
+ */
+void write_special_register(uint32_t sysm, uint32_t value);
+
+/**
+ * Read a register of the system control block.
+ *
+ * @param address The address of the register.
+ */
+uint32_t system_control_read(uint32_t address);
+
+/**
+ * Write a register of the system control block.
+ *
+ * @param address The address of the register.
+ * @param value The value to write.
+ */
+void system_control_write(uint32_t address, uint32_t value);
+}
+
+#endif //THUMBULATOR_EXCEPTION_HPP
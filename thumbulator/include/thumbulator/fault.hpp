@@ -0,0 +1,99 @@
+#ifndef THUMBULATOR_FAULT_HPP
+#define THUMBULATOR_FAULT_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace thumbulator {
+
+/**
+ * The reasons a simulation can fault.
+ */
+enum class fault_type {
+  /**
+   * The instruction could not be decoded.
+   */
+  malformed_instruction,
+
+  /**
+   * The instruction decoded, but cannot be executed by the simulator.
+   */
+  unsupported_instruction,
+
+  /**
+   * A fetch, load, or store outside of the memory map.
+   */
+  memory_out_of_range,
+
+  /**
+   * A branch tried to switch to ARM mode.
+   */
+  interworking,
+
+  /**
+   * The program counter does not point to a thumb instruction.
+   */
+  invalid_pc,
+
+  /**
+   * The CPU went to sleep with nothing scheduled that could wake it up.
+   */
+  deadlock
+};
+
+/**
+ * A fatal error in the simulated application.
+ *
+ * Thrown instead of exiting, so that one faulty simulation does not end the process.
+ */
+class fault : public std::runtime_error {
+public:
+  /**
+   * Constructor.
+   *
+   * @param type The reason for the fault.
+   * @param pc The address of the faulting instruction.
+   * @param address The address that was accessed, or the target of a branch.
+   * @param opcode The faulting instruction, or 0 if it was not fetched.
+   */
+  fault(fault_type type, uint32_t pc, uint32_t address, uint16_t opcode)
+      : std::runtime_error(describe(type, pc, address, opcode))
+      , fault_reason(type)
+      , fault_pc(pc)
+      , fault_address(address)
+      , fault_opcode(opcode)
+  {
+  }
+
+  fault_type type() const
+  {
+    return fault_reason;
+  }
+
+  uint32_t pc() const
+  {
+    return fault_pc;
+  }
+
+  uint32_t address() const
+  {
+    return fault_address;
+  }
+
+  uint16_t opcode() const
+  {
+    return fault_opcode;
+  }
+
+private:
+  fault_type fault_reason;
+  uint32_t fault_pc;
+  uint32_t fault_address;
+  uint16_t fault_opcode;
+
+  static std::string describe(fault_type type, uint32_t pc, uint32_t address, uint16_t opcode);
+};
+}
+
+#endif //THUMBULATOR_FAULT_HPP
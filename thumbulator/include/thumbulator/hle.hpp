@@ -0,0 +1,84 @@
+#ifndef THUMBULATOR_HLE_HPP
+#define THUMBULATOR_HLE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace thumbulator {
+
+class symbol_table;
+
+/**
+ * Whether load_program executes the runtime helpers of ELF files natively.
+ *
+ * The helpers are the compiler's division routines (__aeabi_uidiv, __aeabi_idiv, and their divmod
+ * variants) and the C library's memcpy and memset, including their __aeabi_ variants.
+ */
+extern bool INTERCEPT_RUNTIME_HELPERS;
+
+/**
+ * The number of instructions the last executed instruction stands for.
+ *
+ * Zero, unless the instruction trapped into a runtime helper that was executed natively. Cleared
+ * by whoever steps the CPU, like BRANCH_WAS_TAKEN.
+ */
+extern uint32_t NATIVE_INSTRUCTIONS;
+
+/**
+ * Decide if a runtime helper executes natively.
+ *
+ * The first parameter is the number of instructions the helper would have executed.
+ * The second parameter is the number of cycles the helper would have taken.
+ *
+ * The function returns true to execute the helper natively, or false to emulate the helper's own
+ * instructions. Helpers always execute natively if there is no hook.
+ */
+extern std::function<bool(uint32_t, uint32_t)> native_helper_hook;
+
+/**
+ * Trap the calls to the runtime helpers found in the symbol table.
+ *
+ * The first instruction of every helper in flash is replaced with an undefined instruction that
+ * traps into a native implementation. Memory is still accessed through load and store, so the RAM
+ * hooks see the helper's side effects. Helpers that are not executed natively execute the
+ * replaced instruction instead, then continue with their own instructions.
+ *
+ * @param symbols The symbols of the application.
+ *
+ * @return The number of helpers that were trapped.
+ */
+uint32_t intercept_runtime_helpers(symbol_table const &symbols);
+
+/**
+ * Execute the runtime helper that an undefined instruction traps into.
+ *
+ * Returns to the caller of the helper, as the helper's own bx lr would.
+ *
+ * @param cycles The number of cycles the helper would have taken.
+ *
+ * @return true if the helper executed natively, false if native_helper_hook declined it.
+ */
+bool execute_runtime_helper(uint32_t *cycles);
+
+/**
+ * Get the instruction a trap replaced.
+ *
+ * @param address The address of the trap.
+ */
+uint16_t displaced_instruction(uint32_t address);
+
+/**
+ * The instructions replaced by traps, as pairs of the trap's address and the instruction.
+ */
+std::vector<std::pair<uint32_t, uint16_t>> displaced_instructions();
+
+/**
+ * Replace the instructions recorded for the traps in flash, like when flash is restored from a
+ * snapshot with the traps in it.
+ */
+void set_displaced_instructions(std::vector<std::pair<uint32_t, uint16_t>> const &instructions);
+}
+
+#endif //THUMBULATOR_HLE_HPP
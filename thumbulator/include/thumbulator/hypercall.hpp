@@ -0,0 +1,57 @@
+#ifndef THUMBULATOR_HYPERCALL_HPP
+#define THUMBULATOR_HYPERCALL_HPP
+
+#include <cstdint>
+#include <functional>
+
+namespace thumbulator {
+
+/**
+ * The calls an application can make to the simulator, encoded as svc immediates.
+ *
+ * Arguments are passed in r0 and r1, which are left unchanged. Immediates from 0x02 to 0x0F are
+ * reserved for hypercalls, the ones without a name are delivered as they are. svc #0x01 exits, and
+ * every other immediate raises SVCall.
+ */
+enum class hypercall : uint8_t {
+  /**
+   * The application finished a task and starts the next one, r0 is the next task's identifier.
+   */
+  task_boundary = 0x02,
+
+  /**
+   * The application asks for a checkpoint.
+   */
+  checkpoint = 0x03,
+
+  /**
+   * The r1 bytes starting at r0 live in non-volatile memory.
+   */
+  declare_non_volatile = 0x04,
+
+  /**
+   * The region of interest r0 begins.
+   */
+  region_begin = 0x05,
+
+  /**
+   * The region of interest r0 ends.
+   */
+  region_end = 0x06
+};
+
+constexpr uint8_t FIRST_HYPERCALL = 0x02;
+constexpr uint8_t LAST_HYPERCALL = 0x0F;
+
+/**
+ * Hook into the hypercalls of the application.
+ *
+ * The first parameter is the hypercall.
+ * The second and third parameters are the arguments in r0 and r1.
+ *
+ * Hypercalls do nothing if there is no hook.
+ */
+extern std::function<void(hypercall, uint32_t, uint32_t)> hypercall_hook;
+}
+
+#endif //THUMBULATOR_HYPERCALL_HPP
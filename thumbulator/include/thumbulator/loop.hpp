@@ -0,0 +1,126 @@
+#ifndef THUMBULATOR_LOOP_HPP
+#define THUMBULATOR_LOOP_HPP
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace thumbulator {
+
+/**
+ * Whether simulators execute the iterations of recognized loops at once.
+ */
+extern bool ACCELERATE_LOOPS;
+
+/**
+ * Iterations of a loop that execute at once.
+ */
+struct loop_run {
+  /**
+   * The address of the branch that closes the loop.
+   */
+  uint32_t branch;
+
+  uint64_t iterations;
+  uint32_t instructions_per_iteration;
+  uint32_t cycles_per_iteration;
+
+  /**
+   * The cycles the loads and stores of an iteration stall for in the regions of the address map.
+   */
+  uint32_t stalls_per_iteration;
+
+  uint64_t instructions() const
+  {
+    return iterations * instructions_per_iteration;
+  }
+
+  uint64_t cycles() const
+  {
+    return iterations * (cycles_per_iteration + stalls_per_iteration);
+  }
+};
+
+/**
+ * Recognizes tight loops and executes their iterations without interpreting every instruction.
+ *
+ * Loops are recognized when their closing branch is taken backwards. The idioms are:
+ *  - copy and fill loops of loads, stores, and pointer or counter increments,
+ *  - delay loops that only count, and
+ *  - loops that poll the COUNTFLAG of SYSTICK.
+ * The number of iterations is computed from the registers, and runs end before the next event is
+ * due. The last iteration is always left to the interpreter, so the registers and flags end up
+ * exactly as if every iteration was interpreted. Memory is accessed through load and store, so the
+ * RAM hooks see every access. Each access of the body must stay in one region of the address map,
+ * so every iteration stalls for the same cycles.
+ */
+class loop_accelerator {
+public:
+  /**
+   * Plan the iterations of the loop at the current PC that can execute at once.
+   *
+   * @param branch The address of the backward branch that was just taken.
+   *
+   * @return The run, with zero iterations if the loop is not an idiom, ends in this iteration, or
+   * the PC is not at the start of the loop.
+   */
+  loop_run plan(uint32_t branch);
+
+  /**
+   * Execute the iterations of a run, which may be shortened after it was planned.
+   *
+   * @param run The run to execute.
+   * @param interrupted Checked after every iteration that accessed memory, to end the run early
+   * when an access needs the simulator's attention, or nullptr to execute the whole run.
+   *
+   * @return The iterations that were executed.
+   */
+  loop_run execute(loop_run const &run, std::function<bool()> const &interrupted = nullptr);
+
+private:
+  enum class operation : uint8_t {
+    load,
+    store,
+    add,
+    compare_register,
+    compare_immediate,
+    test,
+    shift
+  };
+
+  struct instruction {
+    operation op;
+    uint8_t width;
+    uint8_t rt;
+    uint8_t rn;
+    // the offset register, or NO_REGISTER if the offset is immediate
+    uint8_t rm;
+    int32_t immediate;
+  };
+
+  enum class idiom : uint8_t { none, counted, poll };
+
+  struct loop_shape {
+    idiom kind;
+    uint32_t start;
+    uint8_t condition;
+    uint32_t cycles;
+    std::vector<instruction> body;
+  };
+
+  static constexpr uint8_t NO_REGISTER = 0xFF;
+
+  std::unordered_map<uint32_t, loop_shape> shapes;
+
+  loop_shape analyze(uint32_t branch) const;
+
+  uint64_t counted_iterations(loop_shape const &shape) const;
+
+  uint64_t poll_iterations(loop_shape const &shape) const;
+
+  bool accesses_fit(loop_shape const &shape, uint64_t iterations, uint32_t *stalls) const;
+};
+}
+
+#endif //THUMBULATOR_LOOP_HPP
@@ -73,6 +73,102 @@ void load(uint32_t address, uint32_t *value, uint32_t false_read);
  * @param value The data to store at that address.
  */
 void store(uint32_t address, uint32_t value);
+
+#define MEMORY_PAGE_SIZE 256
+#define MEMORY_POISON 0xDEADBEEF
+
+/**
+ * A region of the address map, and the costs of the memory technology it is built from.
+ *
+ * Accesses outside of every region cost nothing extra, and keep their data across power failures.
+ */
+struct memory_region {
+  uint32_t start;
+  uint32_t size_bytes;
+
+  // the cycles a load or a store stalls for
+  uint32_t read_latency;
+  uint32_t write_latency;
+
+  // the energy of a load or a store, on top of the instruction's
+  double read_energy;
+  double write_energy;
+
+  // whether the data is lost when the power fails
+  bool is_volatile;
+};
+
+/**
+ * Add a region to the address map.
+ *
+ * Volatile regions must be in RAM, and regions must not overlap.
+ */
+void add_memory_region(memory_region const &region);
+
+/**
+ * Remove every region from the address map.
+ */
+void clear_memory_regions();
+
+/**
+ * The region an address is in, or nullptr if it is in none.
+ */
+memory_region const *find_memory_region(uint32_t address);
+
+/**
+ * Whether the addresses from first to last are all in the same region, or all in none.
+ */
+bool in_one_memory_region(uint32_t first, uint32_t last);
+
+/**
+ * The stall cycles of the loads and stores to regions that were not taken yet.
+ */
+extern uint32_t MEMORY_STALLS;
+
+/**
+ * The energy of the loads and stores to regions that was not taken yet.
+ */
+extern double MEMORY_ENERGY;
+
+/**
+ * The stall cycles of the loads and stores since the last call.
+ *
+ * The interpreter adds them to the instruction that made the accesses, and the loop accelerator
+ * includes them in the cycles of its runs.
+ */
+inline uint32_t take_memory_stalls()
+{
+  auto const stalls = MEMORY_STALLS;
+  MEMORY_STALLS = 0;
+
+  return stalls;
+}
+
+/**
+ * The energy of the loads and stores since the last call.
+ */
+inline double take_memory_energy()
+{
+  auto const energy = MEMORY_ENERGY;
+  MEMORY_ENERGY = 0.0;
+
+  return energy;
+}
+
+/**
+ * Track the pages of volatile regions that already hold data, like those written by the loader.
+ */
+void track_loaded_memory();
+
+/**
+ * Lose the data of volatile regions, as a power failure does.
+ *
+ * Only the pages that ever held data are poisoned, and they stay tracked, since the simulator can
+ * write them back without a store.
+ *
+ * @return The number of pages poisoned.
+ */
+uint64_t power_off_memory();
 }
 
 #endif
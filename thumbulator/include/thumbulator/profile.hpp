@@ -0,0 +1,73 @@
+#ifndef THUMBULATOR_PROFILE_HPP
+#define THUMBULATOR_PROFILE_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "thumbulator/memory.hpp"
+
+namespace thumbulator {
+
+/**
+ * The counters of one instruction address.
+ */
+struct pc_counters {
+  uint64_t executions;
+  uint64_t cycles;
+};
+
+/**
+ * Counts executions and cycles of every instruction in FLASH_MEMORY.
+ *
+ * The counters are a flat array indexed by the halfword offset of the instruction. The array is
+ * allocated lazily by the operating system, so only pages of executed code use memory.
+ */
+class execution_profile {
+public:
+  execution_profile();
+
+  /**
+   * Count an execution of the instruction at an address.
+   *
+   * Instructions outside of FLASH_MEMORY are not counted.
+   *
+   * @param address The address of the instruction.
+   * @param cycles The number of cycles the instruction took.
+   */
+  void record(uint32_t address, uint32_t cycles)
+  {
+    auto const index = (address - FLASH_START) >> 1;
+    if(index < ENTRIES) {
+      auto &entry = counters[index];
+      entry.executions++;
+      entry.cycles += cycles;
+    }
+  }
+
+  /**
+   * Get the counters of an address.
+   */
+  pc_counters const &at(uint32_t address) const
+  {
+    return counters[(address - FLASH_START) >> 1];
+  }
+
+  /**
+   * @return The address and counters of every executed instruction, with the most cycles first.
+   */
+  std::vector<std::pair<uint32_t, pc_counters>> hot_spots() const;
+
+  /**
+   * The number of instructions that can be profiled.
+   */
+  static constexpr uint32_t ENTRIES = FLASH_SIZE_BYTES >> 1;
+
+private:
+  std::unique_ptr<pc_counters[], decltype(&std::free)> counters;
+};
+}
+
+#endif //THUMBULATOR_PROFILE_HPP
@@ -0,0 +1,94 @@
+#ifndef THUMBULATOR_PROGRAM_HPP
+#define THUMBULATOR_PROGRAM_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace thumbulator {
+
+/**
+ * A function or data object of the application.
+ */
+struct symbol {
+  std::string name;
+
+  /**
+   * The first address, without the thumb bit of functions.
+   */
+  uint32_t address;
+
+  /**
+   * The size in bytes, zero if unknown.
+   */
+  uint32_t size;
+
+  bool is_function;
+};
+
+/**
+ * The symbols of an application, searchable by name and by address.
+ */
+class symbol_table {
+public:
+  /**
+   * Add a symbol, which hides earlier symbols with the same name.
+   */
+  void add(symbol const &to_add);
+
+  /**
+   * Find a symbol by name.
+   *
+   * @return The symbol, or nullptr if there is none.
+   */
+  symbol const *find(std::string const &name) const;
+
+  /**
+   * Find the function that contains an address.
+   *
+   * @return The function, or nullptr if no function contains the address.
+   */
+  symbol const *function_at(uint32_t address) const;
+
+  bool empty() const
+  {
+    return symbols.empty();
+  }
+
+private:
+  std::vector<symbol> symbols;
+  std::unordered_map<std::string, size_t> by_name;
+
+  // indices of the functions, sorted by address
+  std::vector<size_t> functions;
+};
+
+/**
+ * Load an application into memory.
+ *
+ * ARM ELF files are recognized by their magic number. Every PT_LOAD segment is placed at its
+ * virtual address, and also at its load address if the two differ, so initialized RAM data is
+ * ready without the startup code copying it. Any other file is a raw image of FLASH_MEMORY.
+ *
+ * Memory must be cleared beforehand, and the entry point and stack pointer still come from the
+ * vector table in cpu_reset. The runtime helpers of ELF files are trapped if
+ * INTERCEPT_RUNTIME_HELPERS is set.
+ *
+ * @param path_to_program The path to the ELF file or raw binary.
+ *
+ * @return The symbols of an ELF file, or an empty table for a raw binary.
+ */
+symbol_table load_program(std::string const &path_to_program);
+
+/**
+ * Read the symbols of an application, without loading it.
+ *
+ * @param path_to_program The path to the ELF file or raw binary.
+ *
+ * @return The symbols of an ELF file, or an empty table for a raw binary.
+ */
+symbol_table read_symbols(std::string const &path_to_program);
+}
+
+#endif //THUMBULATOR_PROGRAM_HPP
@@ -0,0 +1,74 @@
+#include "thumbulator/console.hpp"
+
+#include "thumbulator/cpu.hpp"
+#include "thumbulator/memory.hpp"
+
+#include <vector>
+
+namespace thumbulator {
+
+std::function<void(char const *, size_t)> console_flush_hook;
+
+namespace {
+
+constexpr uint32_t SYS_WRITEC = 0x03;
+constexpr uint32_t SYS_WRITE0 = 0x04;
+
+std::vector<char> buffer;
+
+char load_character(uint32_t address)
+{
+  // the debugger reads memory, not the program, so the RAM hooks and memory regions do not see it
+  uint32_t word;
+  load(address & ~0x3u, &word, 1);
+
+  return static_cast<char>((word >> (8 * (address & 0x3))) & 0xFF);
+}
+}
+
+void console_write(char character)
+{
+  if(console_flush_hook == nullptr) {
+    return;
+  }
+
+  if(buffer.capacity() < CONSOLE_BUFFER_SIZE) {
+    buffer.reserve(CONSOLE_BUFFER_SIZE);
+  }
+
+  buffer.push_back(character);
+  if(buffer.size() == CONSOLE_BUFFER_SIZE) {
+    console_flush();
+  }
+}
+
+void console_flush()
+{
+  if(!buffer.empty() && console_flush_hook != nullptr) {
+    console_flush_hook(buffer.data(), buffer.size());
+  }
+
+  buffer.clear();
+}
+
+void semihosting_call()
+{
+  auto const operation = cpu_get_gpr(0);
+  auto const parameter = cpu_get_gpr(1);
+
+  if(operation == SYS_WRITEC) {
+    console_write(load_character(parameter));
+  } else if(operation == SYS_WRITE0) {
+    for(auto address = parameter;; ++address) {
+      auto const character = load_character(address);
+      if(character == '\0') {
+        break;
+      }
+
+      console_write(character);
+    }
+  } else {
+    cpu_set_gpr(0, 0xFFFFFFFF);
+  }
+}
+}
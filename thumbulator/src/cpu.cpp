@@ -1,5 +1,9 @@
 #include "thumbulator/cpu.hpp"
 
+#include "thumbulator/event.hpp"
+#include "thumbulator/exception.hpp"
+#include "thumbulator/hle.hpp"
+#include "thumbulator/hypercall.hpp"
 #include "thumbulator/memory.hpp"
 #include "cpu_flags.hpp"
 #include "exit.hpp"
@@ -12,6 +16,8 @@ uint16_t insn;
 
 bool BRANCH_WAS_TAKEN = false;
 bool EXIT_INSTRUCTION_ENCOUNTERED = false;
+bool CPU_IS_SLEEPING = false;
+bool EVENT_REGISTER = false;
 
 // Reset CPU state in accordance with B1.5.5 and B3.2.2
 void cpu_reset()
@@ -46,13 +52,21 @@ void cpu_reset()
   load(0x4, &startAddr, 0);
   cpu_set_pc(startAddr);
 
-  // No pending exceptions
+  // No pending or active exceptions, thread mode, default priorities
   cpu.exceptmask = 0;
+  cpu.exceptactive = 0;
+  cpu.vtor = 0;
+  cpu.shpr2 = 0;
+  cpu.shpr3 = 0;
+  cpu_mode_thread();
+
+  // Awake, with no event recorded
+  CPU_IS_SLEEPING = false;
+  EVENT_REGISTER = false;
 
   // Check for attempts to go to ARM mode
   if((cpu_get_pc() & 0x1) == 0) {
-    printf("Error: Reset PC to an ARM address 0x%08X\n", cpu_get_pc());
-    terminate_simulation(1);
+    throw fault(fault_type::invalid_pc, cpu_get_pc(), cpu_get_pc(), 0);
   }
 
   // Reset the SYSTICK unit
@@ -60,6 +74,8 @@ void cpu_reset()
   SYSTICK.reload = 0x0;
   SYSTICK.value = 0x0;
   SYSTICK.calib = CPU_FREQ / 100 | 0x80000000;
+  clear_events();
+  systick_resume();
 }
 
 cpu_state cpu;
@@ -132,12 +148,15 @@ uint32_t rev(decode_result const *);
 uint32_t rev16(decode_result const *);
 uint32_t revsh(decode_result const *);
 uint32_t breakpoint(decode_result const *);
+uint32_t hint(decode_result const *);
+uint32_t svc(decode_result const *);
+uint32_t svc_hypercall(decode_result const *);
+uint32_t cps(decode_result const *);
+uint32_t system(decode_result const *);
 
 uint32_t exmemwb_error(decode_result const *decoded)
 {
-  fprintf(stderr, "Error: Unsupported instruction: Unable to execute\n");
-  terminate_simulation(1);
-  return 0;
+  terminate_simulation(fault_type::unsupported_instruction, cpu_get_pc() - 0x4, insn);
 }
 
 uint32_t exmemwb_exit_simulation(decode_result const *decoded)
@@ -239,6 +258,20 @@ uint32_t entry44(decode_result const *decoded)
   return executeJumpTable44[(insn >> 6) & 0xF](decoded);
 }
 
+uint32_t entry45(decode_result const *decoded)
+{
+  // push, cps, or undefined
+  if((insn & 0x0200) == 0) {
+    return push(decoded);
+  }
+
+  if((insn & 0xFFEF) == 0xB662) {
+    return cps(decoded);
+  }
+
+  return exmemwb_error(decoded);
+}
+
 uint32_t (*executeJumpTable46[16])(decode_result const *) = {exmemwb_error, exmemwb_error,
     exmemwb_error, exmemwb_error, exmemwb_error, exmemwb_error, exmemwb_error, exmemwb_error, rev,
     rev16, exmemwb_error, exmemwb_error, exmemwb_error, exmemwb_error, exmemwb_error,
@@ -249,18 +282,36 @@ uint32_t entry46(decode_result const *decoded)
   return executeJumpTable46[(insn >> 6) & 0xF](decoded);
 }
 
-uint32_t (*executeJumpTable47[2])(decode_result const *) = {
-    pop,       /* (2F0 - 2F7) */
-    breakpoint /* (2F8 - 2FB) */
+uint32_t (*executeJumpTable47[4])(decode_result const *) = {
+    pop,        /* (2F0 - 2F3) */
+    pop,        /* (2F4 - 2F7) */
+    breakpoint, /* (2F8 - 2FB) */
+    hint        /* (2FC - 2FF) */
 };
 
 uint32_t entry47(decode_result const *decoded)
 {
-  return executeJumpTable47[(insn >> 9) & 0x1](decoded);
+  return executeJumpTable47[(insn >> 8) & 0x3](decoded);
 }
 
+extern uint32_t (*executeJumpTable[64])(decode_result const *);
+
 uint32_t entry55(decode_result const *decoded)
 {
+  // udf, which traps into runtime helpers executed natively
+  if((insn & 0xFF00) == 0xDE00) {
+    uint32_t cycles;
+    if(execute_runtime_helper(&cycles)) {
+      return cycles;
+    }
+
+    // emulate the helper instead, starting with the instruction the trap replaced
+    insn = displaced_instruction((cpu_get_pc() - 0x4) & ~0x1u);
+    auto const replaced = decode(insn);
+
+    return executeJumpTable[insn >> 10](&replaced);
+  }
+
   if((insn & 0x0300) != 0x0300) {
     return b_c(decoded);
   }
@@ -269,6 +320,27 @@ uint32_t entry55(decode_result const *decoded)
     return exmemwb_exit_simulation(decoded);
   }
 
+  if((insn & 0xFF) >= FIRST_HYPERCALL && (insn & 0xFF) <= LAST_HYPERCALL) {
+    return svc_hypercall(decoded);
+  }
+
+  return svc(decoded);
+}
+
+uint32_t entry60(decode_result const *decoded)
+{
+  // bl shares its first half with the 32 bit system instructions, the second half tells them apart
+  uint16_t secondHalf;
+  fetch_instruction(cpu_get_pc() - 0x2, &secondHalf);
+
+  if((secondHalf & 0xD000) == 0xD000) {
+    return bl(decoded);
+  }
+
+  if((insn & 0xFF00) == 0xF300 && (secondHalf & 0xC000) == 0x8000) {
+    return system(decoded);
+  }
+
   return exmemwb_error(decoded);
 }
 
@@ -283,11 +355,11 @@ uint32_t (*executeJumpTable[64])(decode_result const *) = {lsls_i, lsls_i, lsrs_
     entry23,                                                                   /* 23 */
     str_i, str_i, ldr_i, ldr_i, strb_i, strb_i, ldrb_i, ldrb_i, strh_i, strh_i, ldrh_i, ldrh_i,
     str_sp, str_sp, ldr_sp, ldr_sp, adr, adr, add_sp, add_sp, entry44, /* 44 */
-    push, entry46,                                                     /* 46 */
+    entry45, entry46,                                                  /* 46 */
     entry47,                                                           /* 47 */
     stm, stm, ldm, ldm, b_c, b_c, b_c, entry55,                        /* 55 */
-    b, b, exmemwb_error, exmemwb_error, bl,                            /* 60 ignore mrs */
-    bl,                                                                /* 61 ignore udef */
+    b, b, exmemwb_error, exmemwb_error, entry60,                       /* 60 */
+    entry60,                                                           /* 61 */
     exmemwb_error, exmemwb_error};
 
 uint32_t exmemwb(uint16_t instruction, decode_result const *decoded)
@@ -295,19 +367,10 @@ uint32_t exmemwb(uint16_t instruction, decode_result const *decoded)
   insn = instruction;
 
   uint32_t insnTicks = executeJumpTable[instruction >> 10](decoded);
+  // loads and stores to slow memory stall the instruction
+  insnTicks += take_memory_stalls();
 
-  // Update the SYSTICK unit and look for resets
-  if(SYSTICK.control & 0x1) {
-    if(insnTicks >= SYSTICK.value) {
-      // Ignore resets due to reads
-      if(SYSTICK.value > 0)
-        SYSTICK.control |= 0x00010000;
-
-      SYSTICK.value = SYSTICK.reload - insnTicks + SYSTICK.value;
-    } else
-      SYSTICK.value -= insnTicks;
-  }
-
-  return insnTicks;
+  // SYSTICK and exceptions only need attention when an event is due
+  return insnTicks + advance_cycles(insnTicks);
 }
 }
@@ -176,9 +176,7 @@ decode_result decode_mov_r(const uint16_t pInsn)
 // Stop simulation if we cannot decode the instruction
 decode_result decode_error(const uint16_t pInsn)
 {
-  fprintf(stderr, "Error: Malformed instruction: Unable to decode: 0x%4.4X at 0x%08X\n", pInsn,
-      cpu_get_pc() - 4);
-  terminate_simulation(1);
+  terminate_simulation(fault_type::malformed_instruction, cpu_get_pc() - 0x4, pInsn);
 }
 
 // Decode functions that require more opcode bits than the first 6
@@ -196,19 +194,20 @@ decode_result (*decodeJumpTable44[4])(const uint16_t pInsn) = {
 decode_result (*decodeJumpTable47[4])(const uint16_t pInsn) = {
     decode_pop,              /* 10_1111_0XXX (2F0 - 2F7) */
     decode_pop, decode_imm8, /* 10_1111_10XX (2F8 - 2FB) */
-    decode_error};
+    decode_imm8              /* 10_1111_11XX (2FC - 2FF) */
+};
 
 decode_result decode_17(const uint16_t pInsn)
 {
-  decodeJumpTable17[(pInsn >> 8) & 0x3](pInsn);
+  return decodeJumpTable17[(pInsn >> 8) & 0x3](pInsn);
 }
 decode_result decode_44(const uint16_t pInsn)
 {
-  decodeJumpTable44[(pInsn >> 8) & 0x3](pInsn);
+  return decodeJumpTable44[(pInsn >> 8) & 0x3](pInsn);
 }
 decode_result decode_47(const uint16_t pInsn)
 {
-  decodeJumpTable47[(pInsn >> 8) & 0x3](pInsn);
+  return decodeJumpTable47[(pInsn >> 8) & 0x3](pInsn);
 }
 
 // Use a table of function pointers indexed by the instruction
@@ -0,0 +1,89 @@
+#include "thumbulator/event.hpp"
+
+#include "thumbulator/cpu.hpp"
+#include "thumbulator/exception.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace thumbulator {
+
+constexpr auto NO_EVENT = std::numeric_limits<uint64_t>::max();
+constexpr auto EVENT_SOURCES = static_cast<size_t>(event_type::count);
+
+uint64_t CYCLE_COUNT = 0;
+uint64_t NEXT_EVENT_CYCLE = NO_EVENT;
+
+namespace {
+
+std::array<uint64_t, EVENT_SOURCES> no_events()
+{
+  std::array<uint64_t, EVENT_SOURCES> none;
+  none.fill(NO_EVENT);
+
+  return none;
+}
+
+// the cycle each source's event is due at, there are too few sources to need a heap
+std::array<uint64_t, EVENT_SOURCES> due = no_events();
+
+void find_next_event()
+{
+  NEXT_EVENT_CYCLE = *std::min_element(due.begin(), due.end());
+}
+
+uint32_t handle(event_type type, uint64_t cycle)
+{
+  switch(type) {
+  case event_type::systick_wrap:
+    systick_wrap(cycle);
+    break;
+  case event_type::exception:
+    return take_pending_exception();
+  case event_type::count:
+    break;
+  }
+
+  return 0;
+}
+}
+
+void schedule_event(event_type type, uint64_t cycle)
+{
+  due[static_cast<size_t>(type)] = cycle;
+  find_next_event();
+}
+
+void cancel_event(event_type type)
+{
+  schedule_event(type, NO_EVENT);
+}
+
+void clear_events()
+{
+  due.fill(NO_EVENT);
+  NEXT_EVENT_CYCLE = NO_EVENT;
+}
+
+uint32_t handle_due_events()
+{
+  uint32_t cycles = 0;
+
+  while(NEXT_EVENT_CYCLE <= CYCLE_COUNT) {
+    auto const next = std::min_element(due.begin(), due.end());
+    auto const type = static_cast<event_type>(next - due.begin());
+    auto const cycle = *next;
+
+    // the handler may schedule the next event of the same source
+    *next = NO_EVENT;
+    find_next_event();
+
+    auto const taken = handle(type, cycle);
+    CYCLE_COUNT += taken;
+    cycles += taken;
+  }
+
+  return cycles;
+}
+}
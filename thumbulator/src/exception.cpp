@@ -0,0 +1,441 @@
+#include "thumbulator/exception.hpp"
+
+#include "thumbulator/event.hpp"
+#include "thumbulator/memory.hpp"
+#include "cpu_flags.hpp"
+#include "exit.hpp"
+
+namespace thumbulator {
+
+namespace {
+
+constexpr uint32_t SCB_CPUID = 0xE000ED00;
+constexpr uint32_t SCB_ICSR = 0xE000ED04;
+constexpr uint32_t SCB_VTOR = 0xE000ED08;
+constexpr uint32_t SCB_AIRCR = 0xE000ED0C;
+constexpr uint32_t SCB_CCR = 0xE000ED14;
+constexpr uint32_t SCB_SHPR2 = 0xE000ED1C;
+constexpr uint32_t SCB_SHPR3 = 0xE000ED20;
+
+// Cortex-M0 r0p0
+constexpr uint32_t CPUID = 0x410CC200;
+
+constexpr uint32_t ICSR_PENDSVSET = 1u << 28;
+constexpr uint32_t ICSR_PENDSVCLR = 1u << 27;
+constexpr uint32_t ICSR_PENDSTSET = 1u << 26;
+constexpr uint32_t ICSR_PENDSTCLR = 1u << 25;
+
+// only the top two bits of each priority are implemented
+constexpr uint32_t SHPR2_MASK = 0xC0000000;
+constexpr uint32_t SHPR3_MASK = 0xC0C00000;
+
+// the execution priority of thread mode, lower than any configurable priority
+constexpr int THREAD_PRIORITY = 4;
+
+constexpr uint32_t EXC_RETURN_HANDLER = 0xFFFFFFF1;
+constexpr uint32_t EXC_RETURN_THREAD_MAIN = 0xFFFFFFF9;
+constexpr uint32_t EXC_RETURN_THREAD_PROCESS = 0xFFFFFFFD;
+
+constexpr uint32_t XPSR_ALIGNED = 1u << 9;
+constexpr uint32_t XPSR_THUMB = 1u << 24;
+
+constexpr uint32_t CONTROL_SPSEL = 0x2;
+
+int priority(uint32_t number)
+{
+  switch(number) {
+  case EXCEPTION_HARD_FAULT:
+    return -1;
+  case EXCEPTION_SVCALL:
+    return static_cast<int>(cpu.shpr2 >> 30);
+  case EXCEPTION_PENDSV:
+    return static_cast<int>((cpu.shpr3 >> 22) & 0x3);
+  case EXCEPTION_SYSTICK:
+    return static_cast<int>(cpu.shpr3 >> 30);
+  default:
+    return THREAD_PRIORITY;
+  }
+}
+
+/**
+ * The priority of the active exception with the highest priority, ignoring PRIMASK.
+ */
+int active_priority()
+{
+  auto current = THREAD_PRIORITY;
+  for(uint32_t number = 0; number < 32; ++number) {
+    if((cpu.exceptactive & (1u << number)) != 0 && priority(number) < current) {
+      current = priority(number);
+    }
+  }
+
+  return current;
+}
+
+/**
+ * The priority an exception must be higher than to preempt.
+ */
+int execution_priority()
+{
+  auto current = active_priority();
+
+  // PRIMASK masks every exception with a configurable priority
+  if((cpu.primask & 0x1) != 0 && current > 0) {
+    current = 0;
+  }
+
+  return current;
+}
+
+/**
+ * The pending exception with the highest priority, or 0 if there is none.
+ */
+uint32_t highest_pending()
+{
+  uint32_t highest = 0;
+  for(uint32_t number = 0; number < 32; ++number) {
+    // on equal priorities, the lowest exception number wins
+    if((cpu.exceptmask & (1u << number)) != 0
+        && (highest == 0 || priority(number) < priority(highest))) {
+      highest = number;
+    }
+  }
+
+  return highest;
+}
+
+bool on_process_stack()
+{
+  return cpu_mode_is_thread() && (cpu.control & CONTROL_SPSEL) != 0;
+}
+
+/**
+ * Switch the banked stack pointer that SP refers to.
+ */
+void use_stack(bool handler, bool process)
+{
+  if(on_process_stack()) {
+    cpu.sp_process = cpu_get_sp();
+  } else {
+    cpu.sp_main = cpu_get_sp();
+  }
+
+  if(handler) {
+    cpu_mode_handler();
+  } else {
+    cpu_mode_thread();
+  }
+
+  if(process) {
+    cpu_stack_use_process();
+  } else {
+    cpu_stack_use_main();
+  }
+
+  cpu_set_sp(on_process_stack() ? cpu.sp_process : cpu.sp_main);
+}
+
+uint32_t program_status()
+{
+  return (cpu_get_apsr() & 0xF0000000) | cpu_get_ipsr();
+}
+
+/**
+ * Whether a pending exception wakes a sleeping CPU up.
+ *
+ * PRIMASK does not keep the CPU asleep, it only stops the exception from being taken.
+ */
+bool wakes_up()
+{
+  auto const number = highest_pending();
+
+  return number != 0 && priority(number) < active_priority();
+}
+}
+
+void pend_exception(exception_number number)
+{
+  cpu.exceptmask |= 1u << number;
+  check_pending_exceptions();
+}
+
+void check_pending_exceptions()
+{
+  if(cpu.exceptmask != 0) {
+    schedule_event(event_type::exception, CYCLE_COUNT);
+  }
+}
+
+bool exception_is_ready()
+{
+  auto const number = highest_pending();
+
+  return number != 0 && priority(number) < execution_priority();
+}
+
+uint32_t take_pending_exception()
+{
+  if(CPU_IS_SLEEPING && wakes_up()) {
+    CPU_IS_SLEEPING = false;
+  }
+
+  if(!exception_is_ready()) {
+    return 0;
+  }
+
+  auto const number = highest_pending();
+
+  // PC seen is PC + 4, unless a branch already moved it to the next instruction
+  auto const return_address = (BRANCH_WAS_TAKEN ? cpu_get_pc() : cpu_get_pc() - 0x2) & ~0x1u;
+
+  // the frame is aligned to 8 bytes, and xPSR records if that moved the stack
+  auto const sp = cpu_get_sp();
+  auto const frame = (sp - 0x20) & ~0x4u;
+  auto const psr = program_status() | XPSR_THUMB | ((sp & 0x4) != 0 ? XPSR_ALIGNED : 0);
+
+  uint32_t const context[8] = {cpu_get_gpr(0), cpu_get_gpr(1), cpu_get_gpr(2), cpu_get_gpr(3),
+      cpu_get_gpr(12), cpu_get_lr(), return_address, psr};
+  for(uint32_t i = 0; i < 8; ++i) {
+    store(frame + 4 * i, context[i]);
+  }
+  cpu_set_sp(frame);
+
+  if(cpu_mode_is_handler()) {
+    cpu_set_lr(EXC_RETURN_HANDLER);
+  } else {
+    cpu_set_lr(on_process_stack() ? EXC_RETURN_THREAD_PROCESS : EXC_RETURN_THREAD_MAIN);
+  }
+
+  // handlers run on the main stack
+  use_stack(true, false);
+  cpu_set_ipsr(number);
+  cpu.exceptmask &= ~(1u << number);
+  cpu.exceptactive |= 1u << number;
+
+  uint32_t handler;
+  load(cpu.vtor + 4 * number, &handler, 1);
+  cpu_set_pc(handler);
+  BRANCH_WAS_TAKEN = true;
+  EVENT_REGISTER = true;
+
+  return TIMING_EXCEPTION_ENTRY;
+}
+
+bool is_exception_return(uint32_t address)
+{
+  return cpu_mode_is_handler() && (address >> 28) == 0xF;
+}
+
+uint32_t exception_return(uint32_t exc_return)
+{
+  auto const number = cpu_get_ipsr();
+  if((cpu.exceptactive & (1u << number)) == 0) {
+    terminate_simulation(fault_type::unsupported_instruction, exc_return, insn);
+  }
+
+  if(exc_return == EXC_RETURN_HANDLER) {
+    use_stack(true, false);
+  } else if(exc_return == EXC_RETURN_THREAD_MAIN) {
+    use_stack(false, false);
+  } else if(exc_return == EXC_RETURN_THREAD_PROCESS) {
+    use_stack(false, true);
+  } else {
+    terminate_simulation(fault_type::unsupported_instruction, exc_return, insn);
+  }
+  cpu.exceptactive &= ~(1u << number);
+
+  auto const frame = cpu_get_sp();
+  uint32_t context[8];
+  for(uint32_t i = 0; i < 8; ++i) {
+    load(frame + 4 * i, &context[i], 0);
+  }
+
+  cpu_set_gpr(0, context[0]);
+  cpu_set_gpr(1, context[1]);
+  cpu_set_gpr(2, context[2]);
+  cpu_set_gpr(3, context[3]);
+  cpu_set_gpr(12, context[4]);
+  cpu_set_lr(context[5]);
+  cpu_set_pc(context[6] | 0x1);
+
+  auto const psr = context[7];
+  cpu_set_sp(frame + 0x20 + ((psr & XPSR_ALIGNED) != 0 ? 0x4 : 0));
+  cpu_set_apsr(psr & 0xF0000000);
+  cpu_set_ipsr(psr & 0x3F);
+
+  BRANCH_WAS_TAKEN = true;
+  EVENT_REGISTER = true;
+
+  // pending exceptions are taken now that the priority dropped
+  check_pending_exceptions();
+
+  return TIMING_EXCEPTION_RETURN;
+}
+
+void wait_for_interrupt()
+{
+  if(!wakes_up()) {
+    CPU_IS_SLEEPING = true;
+  }
+}
+
+void wait_for_event()
+{
+  if(EVENT_REGISTER) {
+    EVENT_REGISTER = false;
+  } else if(!wakes_up()) {
+    CPU_IS_SLEEPING = true;
+  }
+}
+
+void supervisor_call()
+{
+  if(priority(EXCEPTION_SVCALL) < execution_priority()) {
+    pend_exception(EXCEPTION_SVCALL);
+  } else if((cpu.exceptactive & (1u << EXCEPTION_HARD_FAULT)) == 0) {
+    // SVCall escalates to HardFault when it cannot be taken
+    pend_exception(EXCEPTION_HARD_FAULT);
+  } else {
+    // lockup
+    terminate_simulation(fault_type::unsupported_instruction, cpu_get_pc() - 0x4, insn);
+  }
+}
+
+uint32_t read_special_register(uint32_t sysm)
+{
+  switch(sysm) {
+  case 0: // APSR
+  case 1: // IAPSR
+  case 2: // EAPSR
+  case 3: // XPSR
+  case 5: // IPSR
+  case 6: // EPSR
+  case 7: // IEPSR
+  {
+    // EPSR reads as zero
+    auto const apsr = (sysm & 0x4) == 0 ? cpu_get_apsr() & 0xF0000000 : 0;
+    auto const ipsr = (sysm & 0x1) != 0 ? cpu_get_ipsr() : 0;
+
+    return apsr | ipsr;
+  }
+  case 8: // MSP
+    return on_process_stack() ? cpu.sp_main : cpu_get_sp();
+  case 9: // PSP
+    return on_process_stack() ? cpu_get_sp() : cpu.sp_process;
+  case 16: // PRIMASK
+    return cpu.primask & 0x1;
+  case 20: // CONTROL
+    return cpu.control & 0x3;
+  default:
+    return 0;
+  }
+}
+
+void write_special_register(uint32_t sysm, uint32_t value)
+{
+  switch(sysm) {
+  case 0: // APSR
+  case 1: // IAPSR
+  case 2: // EAPSR
+  case 3: // XPSR
+    cpu_set_apsr((cpu_get_apsr() & 0x0FFFFFFF) | (value & 0xF0000000));
+    break;
+  case 8: // MSP
+    if(on_process_stack()) {
+      cpu.sp_main = value & ~0x3u;
+    } else {
+      cpu_set_sp(value & ~0x3u);
+    }
+    break;
+  case 9: // PSP
+    if(on_process_stack()) {
+      cpu_set_sp(value & ~0x3u);
+    } else {
+      cpu.sp_process = value & ~0x3u;
+    }
+    break;
+  case 16: // PRIMASK
+    cpu.primask = value & 0x1;
+    check_pending_exceptions();
+    break;
+  case 20: // CONTROL
+    // handlers always use the main stack, and cannot change the selection
+    if(cpu_mode_is_thread()) {
+      auto const process = (value & CONTROL_SPSEL) != 0;
+      cpu.control = (cpu.control & ~0x1u) | (value & 0x1);
+      use_stack(false, process);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+uint32_t system_control_read(uint32_t address)
+{
+  switch(address) {
+  case SCB_CPUID:
+    return CPUID;
+  case SCB_ICSR: {
+    auto const pending = highest_pending();
+    auto icsr = (cpu_get_ipsr() & 0x3F) | ((pending & 0x3F) << 12);
+    icsr |= (cpu.exceptmask & (1u << EXCEPTION_PENDSV)) != 0 ? ICSR_PENDSVSET : 0;
+    icsr |= (cpu.exceptmask & (1u << EXCEPTION_SYSTICK)) != 0 ? ICSR_PENDSTSET : 0;
+
+    return icsr;
+  }
+  case SCB_VTOR:
+    return cpu.vtor;
+  case SCB_AIRCR:
+    // little endian
+    return 0xFA050000;
+  case SCB_CCR:
+    // unaligned accesses trap, and the stack is aligned to 8 bytes on exception entry
+    return 0x00000208;
+  case SCB_SHPR2:
+    return cpu.shpr2;
+  case SCB_SHPR3:
+    return cpu.shpr3;
+  default:
+    terminate_simulation(fault_type::memory_out_of_range, address, insn);
+  }
+}
+
+void system_control_write(uint32_t address, uint32_t value)
+{
+  switch(address) {
+  case SCB_ICSR:
+    if((value & ICSR_PENDSVCLR) != 0) {
+      cpu.exceptmask &= ~(1u << EXCEPTION_PENDSV);
+    }
+    if((value & ICSR_PENDSTCLR) != 0) {
+      cpu.exceptmask &= ~(1u << EXCEPTION_SYSTICK);
+    }
+    if((value & ICSR_PENDSVSET) != 0) {
+      pend_exception(EXCEPTION_PENDSV);
+    }
+    if((value & ICSR_PENDSTSET) != 0) {
+      pend_exception(EXCEPTION_SYSTICK);
+    }
+    break;
+  case SCB_VTOR:
+    cpu.vtor = value & 0xFFFFFF80;
+    break;
+  case SCB_SHPR2:
+    cpu.shpr2 = value & SHPR2_MASK;
+    check_pending_exceptions();
+    break;
+  case SCB_SHPR3:
+    cpu.shpr3 = value & SHPR3_MASK;
+    check_pending_exceptions();
+    break;
+  case SCB_CPUID:
+  case SCB_AIRCR:
+  case SCB_CCR:
+    // read-only, or writes that the simulator does not model
+    break;
+  default:
+    terminate_simulation(fault_type::memory_out_of_range, address, insn);
+  }
+}
+}
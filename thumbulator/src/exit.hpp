@@ -1,20 +1,29 @@
 #ifndef THUMBULATOR_EXIT_HPP
 #define THUMBULATOR_EXIT_HPP
 
-#include <cstdio>
-#include <cstdlib>
+#include "thumbulator/cpu.hpp"
+#include "thumbulator/fault.hpp"
 
 namespace thumbulator {
 
+/**
+ * The instruction in the execute stage.
+ */
+extern uint16_t insn;
+
 /**
  * Terminate the simulation prematurely.
  *
- * Use this on a fatal error.
+ * Use this on a fatal error. The fault is thrown to whoever is running the simulation.
+ *
+ * @param type The reason for the fault.
+ * @param address The address that was accessed, or the target of a branch.
+ * @param opcode The faulting instruction.
  */
-inline void terminate_simulation(int exit_code)
+[[noreturn]] inline void terminate_simulation(fault_type type, uint32_t address, uint16_t opcode)
 {
-  printf("Simulation was terminated prematurely.\n");
-  exit(exit_code);
+  // PC seen is PC + 4
+  throw fault(type, (cpu_get_pc() - 0x4) & ~0x1u, address, opcode);
 }
 }
 #endif //THUMBULATOR_EXIT_HPP
@@ -92,8 +92,7 @@ uint32_t add_r(decode_result const *decoded)
   // Check for malformed instruction
   if(decoded->Rd == 15 && decoded->Rm == 15) {
     //UNPREDICTABLE
-    fprintf(stderr, "Error: Instruction format error.\n");
-    terminate_simulation(1);
+    terminate_simulation(fault_type::malformed_instruction, cpu_get_pc() - 0x4, insn);
   }
 
   uint32_t opA = cpu_get_gpr(decoded->Rd);
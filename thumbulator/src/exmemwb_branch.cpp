@@ -1,3 +1,4 @@
+#include "thumbulator/exception.hpp"
 #include "thumbulator/memory.hpp"
 
 #include "cpu_flags.hpp"
@@ -165,8 +166,7 @@ uint32_t b_c(decode_result const *decoded)
       taken = 1;
     break;
   default:
-    fprintf(stderr, "Error: Malformed instruction!");
-    terminate_simulation(1);
+    terminate_simulation(fault_type::malformed_instruction, cpu_get_pc() - 0x4, insn);
   }
 
   if(taken == 0) {
@@ -190,8 +190,7 @@ uint32_t blx(decode_result const *decoded)
   uint32_t address = cpu_get_gpr(decoded->Rm);
 
   if((address & 0x1) == 0) {
-    fprintf(stderr, "Error: Interworking not supported: 0x%8.8X\n", address);
-    terminate_simulation(1);
+    terminate_simulation(fault_type::interworking, address, insn);
   }
 
   cpu_set_lr(cpu_get_pc() - 0x2);
@@ -210,16 +209,14 @@ uint32_t bx(decode_result const *decoded)
   uint32_t address = cpu_get_gpr(decoded->Rm);
 
   if((address & 0x1) == 0) {
-    fprintf(stderr, "Error: Interworking not supported: 0x%8.8X\n", address);
-    terminate_simulation(1);
+    terminate_simulation(fault_type::interworking, address, insn);
   }
 
-  if((address >> 28) == 0xF) {
-    fprintf(stderr, "Error: CPU exceptions not supported: 0x%8.8X\n", address);
-  } else {
-    cpu_set_pc(address);
+  if(is_exception_return(address)) {
+    return exception_return(address);
   }
 
+  cpu_set_pc(address);
   BRANCH_WAS_TAKEN = 1;
 
   return TIMING_BRANCH;
@@ -1,3 +1,4 @@
+#include "thumbulator/exception.hpp"
 #include "thumbulator/memory.hpp"
 
 #include "cpu_flags.hpp"
@@ -46,8 +47,7 @@ uint32_t stm(decode_result const *decoded)
     int mask = 1 << i;
     if(decoded->register_list & mask) {
       if(i == decoded->Rn && numStored == 0) {
-        fprintf(stderr, "Error: Malformed instruction!\n");
-        terminate_simulation(1);
+        terminate_simulation(fault_type::malformed_instruction, cpu_get_pc() - 0x4, insn);
       }
 
       uint32_t data = cpu_get_gpr(i);
@@ -91,6 +91,11 @@ uint32_t pop(decode_result const *decoded)
 
   cpu_set_sp(address);
 
+  // popping EXC_RETURN into the PC returns from the exception
+  if(BRANCH_WAS_TAKEN && is_exception_return(cpu_get_pc())) {
+    return 1 + numLoaded + exception_return(cpu_get_pc());
+  }
+
   return 1 + numLoaded + BRANCH_WAS_TAKEN ? TIMING_PC_UPDATE : 0;
 }
 
@@ -1,15 +1,119 @@
+#include "thumbulator/console.hpp"
+#include "thumbulator/exception.hpp"
+#include "thumbulator/hypercall.hpp"
 #include "thumbulator/memory.hpp"
 
 #include "cpu_flags.hpp"
+#include "exit.hpp"
 #include "trace.hpp"
 
 namespace thumbulator {
 
+std::function<void(hypercall, uint32_t, uint32_t)> hypercall_hook;
+
 uint32_t breakpoint(decode_result const *decoded)
 {
+  // the debugger serves semihosting requests
+  if(decoded->imm == 0xAB) {
+    TRACE_INSTRUCTION("bkpt #0x%02X\n", decoded->imm);
+    semihosting_call();
+  }
+
   return 0;
 }
 
+// NOP, YIELD, WFE, WFI, and SEV - hints
+uint32_t hint(decode_result const *decoded)
+{
+  switch(insn) {
+  case 0xBF10:
+    // there is no other thread to yield to
+    TRACE_INSTRUCTION("%s\n", "yield");
+    return 1;
+  case 0xBF20:
+    TRACE_INSTRUCTION("%s\n", "wfe");
+    wait_for_event();
+    return TIMING_SLEEP;
+  case 0xBF30:
+    TRACE_INSTRUCTION("%s\n", "wfi");
+    wait_for_interrupt();
+    return TIMING_SLEEP;
+  case 0xBF40:
+    TRACE_INSTRUCTION("%s\n", "sev");
+    EVENT_REGISTER = true;
+    return 1;
+  default:
+    // if-then blocks are not part of armv6m, the remaining hints execute as nop
+    if((insn & 0xF) != 0) {
+      terminate_simulation(fault_type::unsupported_instruction, cpu_get_pc() - 0x4, insn);
+    }
+
+    TRACE_INSTRUCTION("%s\n", "nop");
+    return 1;
+  }
+}
+
+///--- System operations -------------------------------------------///
+
+// SVC - Supervisor call
+uint32_t svc(decode_result const *decoded)
+{
+  TRACE_INSTRUCTION("svc #0x%02X\n", insn & 0xFF);
+
+  supervisor_call();
+
+  return 1;
+}
+
+// SVC - Hypercall to the simulator
+uint32_t svc_hypercall(decode_result const *decoded)
+{
+  TRACE_INSTRUCTION("svc #0x%02X\n", insn & 0xFF);
+
+  if(hypercall_hook != nullptr) {
+    hypercall_hook(static_cast<hypercall>(insn & 0xFF), cpu_get_gpr(0), cpu_get_gpr(1));
+  }
+
+  return 1;
+}
+
+// CPS - Change the PRIMASK
+uint32_t cps(decode_result const *decoded)
+{
+  TRACE_INSTRUCTION("cps%s i\n", (insn & 0x10) != 0 ? "id" : "ie");
+
+  write_special_register(16, (insn >> 4) & 0x1);
+
+  return 1;
+}
+
+// MRS, MSR, and barriers - 32 bit instructions
+uint32_t system(decode_result const *decoded)
+{
+  uint16_t secondHalf;
+  fetch_instruction(cpu_get_pc() - 0x2, &secondHalf);
+
+  if(insn == 0xF3EF && (secondHalf & 0xF000) == 0x8000) {
+    TRACE_INSTRUCTION("mrs r%u, #%u\n", (secondHalf >> 8) & 0xF, secondHalf & 0xFF);
+
+    cpu_set_gpr((secondHalf >> 8) & 0xF, read_special_register(secondHalf & 0xFF));
+  } else if((insn & 0xFFF0) == 0xF380 && (secondHalf & 0xFF00) == 0x8800) {
+    TRACE_INSTRUCTION("msr #%u, r%u\n", secondHalf & 0xFF, insn & 0xF);
+
+    write_special_register(secondHalf & 0xFF, cpu_get_gpr(insn & 0xF));
+  } else if(insn == 0xF3BF && (secondHalf & 0xFFF0) >= 0x8F40 && (secondHalf & 0xFFF0) <= 0x8F60) {
+    // dsb, dmb, and isb: memory accesses complete in order
+    TRACE_INSTRUCTION("barrier 0x%04X\n", secondHalf);
+  } else {
+    terminate_simulation(fault_type::unsupported_instruction, cpu_get_pc() - 0x4, insn);
+  }
+
+  // skip the second half of the instruction
+  cpu_set_pc(cpu_get_pc() + 0x2);
+
+  return TIMING_SYSTEM;
+}
+
 ///--- Move operations -------------------------------------------///
 
 // MOVS - write an immediate to the destination register
@@ -0,0 +1,38 @@
+#include "thumbulator/fault.hpp"
+
+#include <cstdio>
+
+namespace thumbulator {
+
+std::string fault::describe(fault_type type, uint32_t pc, uint32_t address, uint16_t opcode)
+{
+  char buffer[128];
+
+  switch(type) {
+  case fault_type::malformed_instruction:
+    std::snprintf(buffer, sizeof(buffer),
+        "Malformed instruction: Unable to decode: 0x%4.4X at 0x%08X", opcode, pc);
+    break;
+  case fault_type::unsupported_instruction:
+    std::snprintf(buffer, sizeof(buffer),
+        "Unsupported instruction: Unable to execute: 0x%4.4X at 0x%08X", opcode, pc);
+    break;
+  case fault_type::memory_out_of_range:
+    std::snprintf(
+        buffer, sizeof(buffer), "Memory access out of range: 0x%8.8X, pc=0x%08X", address, pc);
+    break;
+  case fault_type::interworking:
+    std::snprintf(buffer, sizeof(buffer), "Interworking not supported: 0x%8.8X, pc=0x%08X",
+        address, pc);
+    break;
+  case fault_type::invalid_pc:
+    std::snprintf(buffer, sizeof(buffer), "PC moved out of thumb mode: 0x%08X", address);
+    break;
+  case fault_type::deadlock:
+    std::snprintf(buffer, sizeof(buffer), "Sleeping with nothing to wake up: pc=0x%08X", pc);
+    break;
+  }
+
+  return buffer;
+}
+}
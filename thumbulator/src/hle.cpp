@@ -0,0 +1,311 @@
+#include "thumbulator/hle.hpp"
+
+#include "thumbulator/memory.hpp"
+#include "thumbulator/program.hpp"
+#include "cpu_flags.hpp"
+#include "exit.hpp"
+
+#include <unordered_map>
+
+namespace thumbulator {
+
+bool INTERCEPT_RUNTIME_HELPERS = false;
+uint32_t NATIVE_INSTRUCTIONS = 0;
+std::function<bool(uint32_t, uint32_t)> native_helper_hook;
+
+namespace {
+
+/**
+ * The cost of a helper, as the guest would have executed it.
+ *
+ * The costs were estimated from the Thumb-1 implementations of libgcc and newlib: division
+ * iterates once per quotient bit, while memcpy and memset copy one byte per iteration.
+ */
+struct helper_cost {
+  uint32_t cycles;
+  uint32_t instructions;
+  uint32_t cycles_per_unit;
+  uint32_t instructions_per_unit;
+};
+
+enum helper : uint8_t {
+  uidiv,
+  uidivmod,
+  idiv,
+  idivmod,
+  copy_bytes,
+  set_bytes,
+  aeabi_set_bytes,
+  clear_bytes
+};
+
+constexpr helper_cost HELPER_COSTS[] = {
+    {12, 10, 7, 5}, // uidiv, per quotient bit
+    {18, 14, 7, 5}, // uidivmod, per quotient bit
+    {20, 16, 7, 5}, // idiv, per quotient bit
+    {26, 20, 7, 5}, // idivmod, per quotient bit
+    {10, 8, 9, 5},  // memcpy, per byte
+    {8, 6, 7, 4},   // memset, per byte
+    {8, 6, 7, 4},   // __aeabi_memset, per byte
+    {8, 6, 7, 4},   // __aeabi_memclr, per byte
+};
+
+struct helper_symbol {
+  char const *name;
+  helper routine;
+};
+
+constexpr helper_symbol HELPER_SYMBOLS[] = {{"__aeabi_uidiv", uidiv}, {"__udivsi3", uidiv},
+    {"__aeabi_uidivmod", uidivmod}, {"__aeabi_idiv", idiv}, {"__divsi3", idiv},
+    {"__aeabi_idivmod", idivmod}, {"memcpy", copy_bytes}, {"__aeabi_memcpy", copy_bytes},
+    {"__aeabi_memcpy4", copy_bytes}, {"__aeabi_memcpy8", copy_bytes}, {"memset", set_bytes},
+    {"__aeabi_memset", aeabi_set_bytes}, {"__aeabi_memset4", aeabi_set_bytes},
+    {"__aeabi_memset8", aeabi_set_bytes}, {"__aeabi_memclr", clear_bytes},
+    {"__aeabi_memclr4", clear_bytes}, {"__aeabi_memclr8", clear_bytes}};
+
+// udf #imm, where the immediate selects the helper
+constexpr uint16_t TRAP_INSTRUCTION = 0xDE80;
+
+// the instructions replaced by traps, by address
+std::unordered_map<uint32_t, uint16_t> displaced;
+
+uint32_t magnitude(uint32_t value)
+{
+  return static_cast<int32_t>(value) < 0 ? 0u - value : value;
+}
+
+uint32_t quotient_bits(uint32_t dividend, uint32_t divisor)
+{
+  if(divisor == 0 || dividend < divisor) {
+    return 0;
+  }
+
+  // the shift-subtract loop runs once for every bit the divisor is shifted by
+  return static_cast<uint32_t>(__builtin_clz(divisor) - __builtin_clz(dividend)) + 1;
+}
+
+/**
+ * The units of work the helper will do with its arguments: quotient bits or bytes.
+ */
+uint32_t units_of_work(helper routine)
+{
+  switch(routine) {
+  case uidiv:
+  case uidivmod:
+    return quotient_bits(cpu_get_gpr(0), cpu_get_gpr(1));
+  case idiv:
+  case idivmod:
+    return quotient_bits(magnitude(cpu_get_gpr(0)), magnitude(cpu_get_gpr(1)));
+  case copy_bytes:
+  case set_bytes:
+    return cpu_get_gpr(2);
+  case aeabi_set_bytes:
+  case clear_bytes:
+    return cpu_get_gpr(1);
+  }
+
+  return 0;
+}
+
+uint32_t load_byte(uint32_t address)
+{
+  uint32_t word;
+  load(address & ~0x3u, &word, 0);
+
+  return (word >> (8 * (address & 0x3))) & 0xFF;
+}
+
+void store_byte(uint32_t address, uint32_t value)
+{
+  // like strb, read the word without the program seeing it, then store the merged word
+  uint32_t word;
+  load(address & ~0x3u, &word, 1);
+
+  auto const shift = 8 * (address & 0x3);
+  store(address & ~0x3u, (word & ~(0xFFu << shift)) | ((value & 0xFF) << shift));
+}
+
+void copy(uint32_t destination, uint32_t source, uint32_t size)
+{
+  // copy whole words when both sides are aligned, bytes otherwise
+  if(((destination | source) & 0x3) == 0) {
+    for(; size >= 4; size -= 4, destination += 4, source += 4) {
+      uint32_t word;
+      load(source, &word, 0);
+      store(destination, word);
+    }
+  }
+
+  for(; size > 0; --size, ++destination, ++source) {
+    store_byte(destination, load_byte(source));
+  }
+}
+
+void fill(uint32_t destination, uint32_t value, uint32_t size)
+{
+  value &= 0xFF;
+
+  for(; size > 0 && (destination & 0x3) != 0; --size, ++destination) {
+    store_byte(destination, value);
+  }
+
+  auto const word = value * 0x01010101u;
+  for(; size >= 4; size -= 4, destination += 4) {
+    store(destination, word);
+  }
+
+  for(; size > 0; --size, ++destination) {
+    store_byte(destination, value);
+  }
+}
+
+void divide_unsigned(bool with_remainder)
+{
+  auto const dividend = cpu_get_gpr(0);
+  auto const divisor = cpu_get_gpr(1);
+
+  // __aeabi_idiv0 returns zero
+  auto const quotient = divisor != 0 ? dividend / divisor : 0;
+  auto const remainder = divisor != 0 ? dividend % divisor : dividend;
+
+  cpu_set_gpr(0, quotient);
+  if(with_remainder) {
+    cpu_set_gpr(1, remainder);
+  }
+}
+
+void divide_signed(bool with_remainder)
+{
+  auto const dividend = static_cast<int32_t>(cpu_get_gpr(0));
+  auto const divisor = static_cast<int32_t>(cpu_get_gpr(1));
+
+  int32_t quotient = 0;
+  int32_t remainder = dividend;
+  if(divisor == -1) {
+    // INT32_MIN / -1 overflows, and wraps like the guest routine
+    quotient = static_cast<int32_t>(0u - static_cast<uint32_t>(dividend));
+    remainder = 0;
+  } else if(divisor != 0) {
+    quotient = dividend / divisor;
+    remainder = dividend % divisor;
+  }
+
+  cpu_set_gpr(0, static_cast<uint32_t>(quotient));
+  if(with_remainder) {
+    cpu_set_gpr(1, static_cast<uint32_t>(remainder));
+  }
+}
+}
+
+uint32_t intercept_runtime_helpers(symbol_table const &symbols)
+{
+  uint32_t intercepted = 0;
+  displaced.clear();
+
+  for(auto const &helper_symbol : HELPER_SYMBOLS) {
+    auto const found = symbols.find(helper_symbol.name);
+    if(found == nullptr || !found->is_function) {
+      continue;
+    }
+
+    // only helpers in flash can be patched before the application starts
+    auto const address = found->address;
+    if(address >= FLASH_START + FLASH_SIZE_BYTES) {
+      continue;
+    }
+
+    auto &word = FLASH_MEMORY[(address & FLASH_ADDRESS_MASK) >> 2];
+    auto const shift = (address & 0x2) != 0 ? 16 : 0;
+    auto const trap = static_cast<uint32_t>(TRAP_INSTRUCTION | helper_symbol.routine);
+
+    // aliases of the same helper share their first instruction
+    if(displaced.count(address) == 0) {
+      displaced.emplace(address, static_cast<uint16_t>(word >> shift));
+    }
+    word = (word & ~(0xFFFFu << shift)) | (trap << shift);
+
+    intercepted++;
+  }
+
+  return intercepted;
+}
+
+bool execute_runtime_helper(uint32_t *cycles)
+{
+  auto const routine = static_cast<uint32_t>(insn & 0xFF) - (TRAP_INSTRUCTION & 0xFF);
+  if((insn & 0xFF) < (TRAP_INSTRUCTION & 0xFF) || routine > clear_bytes) {
+    terminate_simulation(fault_type::unsupported_instruction, cpu_get_pc() - 0x4, insn);
+  }
+
+  auto const units = units_of_work(static_cast<helper>(routine));
+  auto const &cost = HELPER_COSTS[routine];
+  auto const instructions = cost.instructions + cost.instructions_per_unit * units;
+  *cycles = cost.cycles + cost.cycles_per_unit * units;
+
+  if(native_helper_hook != nullptr && !native_helper_hook(instructions, *cycles)) {
+    return false;
+  }
+
+  auto const destination = cpu_get_gpr(0);
+  switch(static_cast<helper>(routine)) {
+  case uidiv:
+    divide_unsigned(false);
+    break;
+  case uidivmod:
+    divide_unsigned(true);
+    break;
+  case idiv:
+    divide_signed(false);
+    break;
+  case idivmod:
+    divide_signed(true);
+    break;
+  case copy_bytes:
+    copy(destination, cpu_get_gpr(1), cpu_get_gpr(2));
+    break;
+  case set_bytes:
+    fill(destination, cpu_get_gpr(1), cpu_get_gpr(2));
+    break;
+  case aeabi_set_bytes:
+    // __aeabi_memset takes the size before the value
+    fill(destination, cpu_get_gpr(2), cpu_get_gpr(1));
+    break;
+  case clear_bytes:
+    fill(destination, 0, cpu_get_gpr(1));
+    break;
+  }
+
+  // return to the caller, like bx lr
+  auto const return_address = cpu_get_lr();
+  if((return_address & 0x1) == 0) {
+    terminate_simulation(fault_type::interworking, return_address, insn);
+  }
+
+  cpu_set_pc(return_address);
+  BRANCH_WAS_TAKEN = true;
+  NATIVE_INSTRUCTIONS = instructions;
+
+  return true;
+}
+
+uint16_t displaced_instruction(uint32_t address)
+{
+  auto const found = displaced.find(address);
+  if(found == displaced.end()) {
+    terminate_simulation(fault_type::unsupported_instruction, address, insn);
+  }
+
+  return found->second;
+}
+
+std::vector<std::pair<uint32_t, uint16_t>> displaced_instructions()
+{
+  return {displaced.begin(), displaced.end()};
+}
+
+void set_displaced_instructions(std::vector<std::pair<uint32_t, uint16_t>> const &instructions)
+{
+  displaced.clear();
+  displaced.insert(instructions.begin(), instructions.end());
+}
+}
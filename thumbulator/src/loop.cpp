@@ -0,0 +1,487 @@
+#include "thumbulator/loop.hpp"
+
+#include "thumbulator/cpu.hpp"
+#include "thumbulator/event.hpp"
+#include "thumbulator/memory.hpp"
+
+#include <algorithm>
+
+namespace thumbulator {
+
+bool ACCELERATE_LOOPS = false;
+
+namespace {
+
+// longer loops do not spend enough time in the branch to be worth it
+constexpr uint32_t MAX_BODY_INSTRUCTIONS = 16;
+
+constexpr uint8_t CONDITION_EQ = 0x0;
+constexpr uint8_t CONDITION_NE = 0x1;
+constexpr uint8_t CONDITION_MI = 0x4;
+constexpr uint8_t CONDITION_PL = 0x5;
+
+constexpr uint32_t SYSTICK_CONTROL = 0xE000E010;
+constexpr uint32_t SYSTICK_ENABLE = 0x1;
+constexpr uint32_t SYSTICK_COUNTFLAG = 0x00010000;
+
+uint32_t read(uint32_t address, uint8_t width)
+{
+  if(width == 4) {
+    uint32_t value;
+    load(address, &value, 0);
+
+    return value;
+  }
+
+  // like ldrb and ldrh, load the word and select the bytes
+  uint32_t word;
+  load(address & ~0x3u, &word, 0);
+
+  auto const mask = width == 1 ? 0xFFu : 0xFFFFu;
+  auto const shift = width == 1 ? 8 * (address & 0x3) : 8 * (address & 0x2);
+
+  return (word >> shift) & mask;
+}
+
+void write(uint32_t address, uint8_t width, uint32_t value)
+{
+  if(width == 4) {
+    store(address, value);
+    return;
+  }
+
+  // like strb and strh, merge into the word without the program seeing the read
+  uint32_t word;
+  load(address & ~0x3u, &word, 1);
+
+  auto const mask = width == 1 ? 0xFFu : 0xFFFFu;
+  auto const shift = width == 1 ? 8 * (address & 0x3) : 8 * (address & 0x2);
+  store(address & ~0x3u, (word & ~(mask << shift)) | ((value & mask) << shift));
+}
+
+bool in_ram(int64_t address)
+{
+  return address >= RAM_START && address < static_cast<int64_t>(RAM_START) + RAM_SIZE_BYTES;
+}
+
+bool in_flash(int64_t address)
+{
+  return address >= FLASH_START && address < FLASH_START + FLASH_SIZE_BYTES;
+}
+
+/**
+ * The iterations that end before the next event is due.
+ */
+uint64_t iterations_before_event(uint32_t cycles_per_iteration)
+{
+  if(NEXT_EVENT_CYCLE <= CYCLE_COUNT) {
+    return 0;
+  }
+
+  return (NEXT_EVENT_CYCLE - CYCLE_COUNT - 1) / cycles_per_iteration;
+}
+
+/**
+ * Find the first iteration whose value is zero, for a value that changes every iteration.
+ *
+ * @return The iteration, or 0 if the value never reaches zero without wrapping around.
+ */
+uint64_t iteration_at_zero(uint32_t first_value, int64_t change)
+{
+  if(change > 0 && ((0u - first_value) % change) == 0) {
+    return (0u - first_value) / change;
+  } else if(change < 0 && (first_value % -change) == 0) {
+    return first_value / -change;
+  }
+
+  return 0;
+}
+}
+
+loop_accelerator::loop_shape loop_accelerator::analyze(uint32_t branch) const
+{
+  loop_shape shape{idiom::none, 0, 0, TIMING_BRANCH, {}};
+
+  uint16_t closing;
+  fetch_instruction(branch, &closing);
+  if((closing & 0xF000) != 0xD000 || ((closing >> 8) & 0xF) >= 0xE) {
+    return shape;
+  }
+
+  auto const offset = static_cast<int32_t>(static_cast<int8_t>(closing & 0xFF)) * 2;
+  auto const start = branch + 4 + offset;
+  if(offset >= -4 || (branch - start) / 2 > MAX_BODY_INSTRUCTIONS) {
+    return shape;
+  }
+  shape.start = start;
+
+  std::vector<instruction> body;
+  for(auto address = start; address < branch; address += 2) {
+    uint16_t encoded;
+    fetch_instruction(address, &encoded);
+
+    auto const low = static_cast<uint8_t>(encoded & 0x7);
+    auto const middle = static_cast<uint8_t>((encoded >> 3) & 0x7);
+    auto const high = static_cast<uint8_t>((encoded >> 6) & 0x7);
+    auto const imm5 = static_cast<int32_t>((encoded >> 6) & 0x1F);
+    auto const rdn = static_cast<uint8_t>((encoded >> 8) & 0x7);
+    auto const imm8 = static_cast<int32_t>(encoded & 0xFF);
+    auto const transfer = (encoded & 0x0800) != 0 ? operation::load : operation::store;
+
+    switch(encoded & 0xF800) {
+    case 0x6800: // ldr rt, [rn, #imm]
+    case 0x6000: // str rt, [rn, #imm]
+      body.push_back({transfer, 4, low, middle, NO_REGISTER, imm5 << 2});
+      continue;
+    case 0x7800: // ldrb rt, [rn, #imm]
+    case 0x7000: // strb rt, [rn, #imm]
+      body.push_back({transfer, 1, low, middle, NO_REGISTER, imm5});
+      continue;
+    case 0x8800: // ldrh rt, [rn, #imm]
+    case 0x8000: // strh rt, [rn, #imm]
+      body.push_back({transfer, 2, low, middle, NO_REGISTER, imm5 << 1});
+      continue;
+    case 0x3000: // adds rdn, #imm
+      body.push_back({operation::add, 0, rdn, rdn, NO_REGISTER, imm8});
+      continue;
+    case 0x3800: // subs rdn, #imm
+      body.push_back({operation::add, 0, rdn, rdn, NO_REGISTER, -imm8});
+      continue;
+    case 0x2800: // cmp rn, #imm
+      body.push_back({operation::compare_immediate, 0, 0, rdn, NO_REGISTER, imm8});
+      continue;
+    case 0x0000: // lsls rd, rm, #imm
+      if(imm5 != 0) {
+        body.push_back({operation::shift, 0, low, middle, NO_REGISTER, imm5});
+        continue;
+      }
+      return shape;
+    default:
+      break;
+    }
+
+    switch(encoded & 0xFE00) {
+    case 0x5800: // ldr rt, [rn, rm]
+    case 0x5000: // str rt, [rn, rm]
+      body.push_back({transfer, 4, low, middle, high, 0});
+      continue;
+    case 0x5C00: // ldrb rt, [rn, rm]
+    case 0x5400: // strb rt, [rn, rm]
+      body.push_back({transfer, 1, low, middle, high, 0});
+      continue;
+    case 0x5A00: // ldrh rt, [rn, rm]
+    case 0x5200: // strh rt, [rn, rm]
+      body.push_back({transfer, 2, low, middle, high, 0});
+      continue;
+    case 0x1C00: // adds rd, rn, #imm
+    case 0x1E00: // subs rd, rn, #imm
+      if(low == middle) {
+        auto const imm3 = static_cast<int32_t>(high);
+        body.push_back({operation::add, 0, low, low, NO_REGISTER, encoded & 0x0200 ? -imm3 : imm3});
+        continue;
+      }
+      return shape;
+    default:
+      break;
+    }
+
+    switch(encoded & 0xFFC0) {
+    case 0x4280: // cmp rn, rm
+      body.push_back({operation::compare_register, 0, 0, low, middle, 0});
+      continue;
+    case 0x4200: // tst rn, rm
+      body.push_back({operation::test, 0, 0, low, middle, 0});
+      continue;
+    default:
+      return shape;
+    }
+  }
+
+  shape.condition = static_cast<uint8_t>((closing >> 8) & 0xF);
+  for(auto const &step : body) {
+    shape.cycles += (step.op == operation::load || step.op == operation::store) ? TIMING_MEM : 1;
+  }
+
+  // polling: ldr rt, [rn, #imm], then lsls rd, rt, #15 and bpl, or tst rt, rm and beq
+  if(body.size() == 2 && body[0].op == operation::load && body[0].width == 4
+      && body[0].rm == NO_REGISTER) {
+    auto const &check = body[1];
+    auto const shifts_flag = check.op == operation::shift && check.rn == body[0].rt
+                             && check.immediate == 15 && shape.condition == CONDITION_PL;
+    auto const tests_flag =
+        check.op == operation::test && check.rn == body[0].rt && shape.condition == CONDITION_EQ;
+
+    if(shifts_flag || tests_flag) {
+      shape.kind = idiom::poll;
+      shape.body = body;
+    }
+
+    return shape;
+  }
+
+  if(shape.condition != CONDITION_NE) {
+    return shape;
+  }
+
+  // counting: registers are either loaded data, or change by a constant every iteration
+  uint8_t loaded = 0;
+  uint8_t counted = 0;
+  for(auto const &step : body) {
+    if(step.op == operation::test || step.op == operation::shift) {
+      return shape;
+    } else if(step.op == operation::load) {
+      loaded |= 1u << step.rt;
+    } else if(step.op == operation::add) {
+      counted |= 1u << step.rt;
+    }
+  }
+
+  if((loaded & counted) != 0) {
+    return shape;
+  }
+
+  auto const is_data = [loaded](uint8_t reg) {
+    return reg != NO_REGISTER && (loaded & (1u << reg)) != 0;
+  };
+
+  bool sets_flags = false;
+  for(auto const &step : body) {
+    auto const addresses = step.op == operation::load || step.op == operation::store;
+    auto const compares =
+        step.op == operation::compare_register || step.op == operation::compare_immediate;
+
+    if((addresses || compares) && (is_data(step.rn) || is_data(step.rm))) {
+      return shape;
+    }
+
+    sets_flags = sets_flags || compares || step.op == operation::add;
+  }
+
+  if(sets_flags) {
+    shape.kind = idiom::counted;
+    shape.body = body;
+  }
+
+  return shape;
+}
+
+uint64_t loop_accelerator::counted_iterations(loop_shape const &shape) const
+{
+  int64_t change[8] = {};
+  for(auto const &step : shape.body) {
+    if(step.op == operation::add) {
+      change[step.rt] += step.immediate;
+    }
+  }
+
+  // the value of a register at an instruction in the first iteration
+  auto const value_at = [&shape](uint8_t reg, size_t index) {
+    auto value = cpu_get_gpr(reg);
+    for(size_t i = 0; i < index; ++i) {
+      if(shape.body[i].op == operation::add && shape.body[i].rt == reg) {
+        value += static_cast<uint32_t>(shape.body[i].immediate);
+      }
+    }
+
+    return value;
+  };
+
+  // the flags of the branch come from the last instruction that sets them
+  auto index = shape.body.size();
+  while(shape.body[index - 1].op == operation::load
+        || shape.body[index - 1].op == operation::store) {
+    --index;
+  }
+
+  auto const &flags = shape.body[index - 1];
+  switch(flags.op) {
+  case operation::add:
+    return iteration_at_zero(value_at(flags.rt, index), change[flags.rt]);
+  case operation::compare_immediate:
+    return iteration_at_zero(
+        value_at(flags.rn, index) - static_cast<uint32_t>(flags.immediate), change[flags.rn]);
+  case operation::compare_register:
+    return iteration_at_zero(
+        value_at(flags.rn, index) - value_at(flags.rm, index), change[flags.rn] - change[flags.rm]);
+  default:
+    return 0;
+  }
+}
+
+uint64_t loop_accelerator::poll_iterations(loop_shape const &shape) const
+{
+  auto const &poll = shape.body[0];
+  if(cpu_get_gpr(poll.rn) + poll.immediate != SYSTICK_CONTROL) {
+    return 0;
+  }
+
+  if(shape.body[1].op == operation::test) {
+    // the mask must only select COUNTFLAG among the bits that are set
+    auto const mask = cpu_get_gpr(shape.body[1].rm);
+    if((mask & SYSTICK_COUNTFLAG) == 0 || (mask & SYSTICK.control & ~SYSTICK_COUNTFLAG) != 0) {
+      return 0;
+    }
+  }
+
+  // the counter reaching zero is the next event, or an earlier one ends the run first
+  if((SYSTICK.control & SYSTICK_ENABLE) == 0 || (SYSTICK.control & SYSTICK_COUNTFLAG) != 0) {
+    return 0;
+  }
+
+  return iterations_before_event(shape.cycles);
+}
+
+bool loop_accelerator::accesses_fit(
+    loop_shape const &shape, uint64_t iterations, uint32_t *stalls) const
+{
+  *stalls = 0;
+
+  int64_t change[8] = {};
+  for(auto const &step : shape.body) {
+    if(step.op == operation::add) {
+      change[step.rt] += step.immediate;
+    }
+  }
+
+  int64_t value[8];
+  for(uint8_t reg = 0; reg < 8; ++reg) {
+    value[reg] = cpu_get_gpr(reg);
+  }
+
+  for(auto const &step : shape.body) {
+    if(step.op == operation::add) {
+      value[step.rt] += step.immediate;
+      continue;
+    } else if(step.op != operation::load && step.op != operation::store) {
+      continue;
+    }
+
+    auto const offset = step.rm == NO_REGISTER ? step.immediate : value[step.rm];
+    auto const stride = change[step.rn] + (step.rm == NO_REGISTER ? 0 : change[step.rm]);
+    auto const first = static_cast<int64_t>(static_cast<uint32_t>(value[step.rn] + offset));
+    auto const last = first + static_cast<int64_t>(iterations - 1) * stride;
+
+    // every access must stay in memory, and stores in RAM, or the fault would come too early
+    auto const lowest = std::min(first, last);
+    auto const highest = std::max(first, last) + step.width - 1;
+    if(step.op == operation::store) {
+      if(!in_ram(lowest) || !in_ram(highest)) {
+        return false;
+      }
+    } else if(!(in_ram(lowest) && in_ram(highest)) && !(in_flash(lowest) && in_flash(highest))) {
+      return false;
+    }
+
+    // accesses that cross into another region would stall differently in some iterations
+    if(!in_one_memory_region(static_cast<uint32_t>(lowest), static_cast<uint32_t>(highest))) {
+      return false;
+    }
+
+    auto const region = find_memory_region(static_cast<uint32_t>(lowest));
+    if(region != nullptr) {
+      *stalls += step.op == operation::load ? region->read_latency : region->write_latency;
+    }
+  }
+
+  return true;
+}
+
+loop_run loop_accelerator::plan(uint32_t branch)
+{
+  auto found = shapes.find(branch);
+  if(found == shapes.end()) {
+    found = shapes.emplace(branch, analyze(branch)).first;
+  }
+
+  auto const &shape = found->second;
+  loop_run run{branch, 0, static_cast<uint32_t>(shape.body.size() + 1), shape.cycles, 0};
+
+  // PC seen is PC + 4, and the lowest bit marks thumb mode
+  if(shape.kind == idiom::none || ((cpu_get_pc() - 0x4) & ~0x1u) != shape.start) {
+    return run;
+  }
+
+  if(shape.kind == idiom::poll) {
+    run.iterations = poll_iterations(shape);
+  } else if(shape.kind == idiom::counted) {
+    // the last iteration is interpreted, to leave the registers and flags as it does
+    auto const remaining = counted_iterations(shape);
+    run.iterations = remaining;
+
+    // events must be handled by the interpreter, after the instruction they are due in
+    run.iterations = std::min(run.iterations, iterations_before_event(shape.cycles));
+
+    if(run.iterations > 0 && !accesses_fit(shape, run.iterations, &run.stalls_per_iteration)) {
+      run.iterations = 0;
+    }
+
+    // the stalls make the iterations longer, so fewer end before the event
+    if(run.stalls_per_iteration > 0) {
+      run.iterations = std::min(
+          run.iterations, iterations_before_event(shape.cycles + run.stalls_per_iteration));
+    }
+  }
+
+  return run;
+}
+
+loop_run loop_accelerator::execute(loop_run const &run, std::function<bool()> const &interrupted)
+{
+  auto const &shape = shapes.at(run.branch);
+  auto executed = run;
+
+  if(shape.kind == idiom::counted) {
+    uint32_t reg[8];
+    for(uint8_t i = 0; i < 8; ++i) {
+      reg[i] = cpu_get_gpr(i);
+    }
+
+    auto const accesses_memory =
+        std::any_of(shape.body.begin(), shape.body.end(), [](instruction const &step) {
+          return step.op == operation::load || step.op == operation::store;
+        });
+
+    for(uint64_t iteration = 0; iteration < run.iterations; ++iteration) {
+      for(auto const &step : shape.body) {
+        switch(step.op) {
+        case operation::load:
+        case operation::store: {
+          auto const offset =
+              step.rm == NO_REGISTER ? static_cast<uint32_t>(step.immediate) : reg[step.rm];
+          auto const address = reg[step.rn] + offset;
+
+          if(step.op == operation::load) {
+            reg[step.rt] = read(address, step.width);
+          } else {
+            write(address, step.width, reg[step.rt]);
+          }
+          break;
+        }
+        case operation::add:
+          reg[step.rt] += static_cast<uint32_t>(step.immediate);
+          break;
+        default:
+          break;
+        }
+      }
+
+      if(accesses_memory && interrupted != nullptr && interrupted()) {
+        executed.iterations = iteration + 1;
+        break;
+      }
+    }
+
+    for(uint8_t i = 0; i < 8; ++i) {
+      cpu_set_gpr(i, reg[i]);
+    }
+  }
+
+  // the stalls of the accesses are already in the cycles of the run
+  take_memory_stalls();
+
+  // polling reads of the control register only clear COUNTFLAG, which is clear
+  advance_cycles(executed.cycles());
+
+  return executed;
+}
+}
@@ -1,10 +1,15 @@
 #include "thumbulator/memory.hpp"
 
-#include <cstdio>
+#include "thumbulator/console.hpp"
+#include "thumbulator/exception.hpp"
 
 #include "cpu_flags.hpp"
 #include "exit.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
 namespace thumbulator {
 
 uint32_t RAM[RAM_SIZE_BYTES >> 2];
@@ -14,6 +19,153 @@ std::function<uint32_t(uint32_t, uint32_t, uint32_t)> ram_store_hook;
 
 uint32_t FLASH_MEMORY[FLASH_SIZE_BYTES >> 2];
 
+uint32_t MEMORY_STALLS = 0;
+double MEMORY_ENERGY = 0.0;
+
+namespace {
+
+/**
+ * A region of the address map, and the pages of it that held data.
+ */
+struct mapped_region {
+  memory_region region;
+
+  std::vector<bool> touched;
+  std::vector<uint32_t> pages;
+};
+
+std::vector<mapped_region> regions;
+
+mapped_region *find_region(uint32_t address)
+{
+  for(auto &mapped : regions) {
+    if(address - mapped.region.start < mapped.region.size_bytes) {
+      return &mapped;
+    }
+  }
+
+  return nullptr;
+}
+
+void touch_page(mapped_region &mapped, uint32_t address)
+{
+  auto const page = (address - mapped.region.start) / MEMORY_PAGE_SIZE;
+  if(!mapped.touched[page]) {
+    mapped.touched[page] = true;
+    mapped.pages.push_back(page);
+  }
+}
+
+void account_load(uint32_t address)
+{
+  auto const mapped = find_region(address);
+  if(mapped != nullptr) {
+    MEMORY_STALLS += mapped->region.read_latency;
+    MEMORY_ENERGY += mapped->region.read_energy;
+  }
+}
+
+void account_store(uint32_t address)
+{
+  auto const mapped = find_region(address);
+  if(mapped != nullptr) {
+    MEMORY_STALLS += mapped->region.write_latency;
+    MEMORY_ENERGY += mapped->region.write_energy;
+
+    if(mapped->region.is_volatile) {
+      touch_page(*mapped, address);
+    }
+  }
+}
+}
+
+void add_memory_region(memory_region const &region)
+{
+  uint64_t const end = static_cast<uint64_t>(region.start) + region.size_bytes;
+  auto const in_ram = region.start >= RAM_START && end <= RAM_START + uint64_t{RAM_SIZE_BYTES};
+  auto const in_flash = end <= FLASH_START + uint64_t{FLASH_SIZE_BYTES};
+
+  if(region.size_bytes == 0 || (!in_ram && !in_flash)) {
+    throw std::runtime_error("Memory region is outside of the simulated memory.");
+  }
+
+  if(region.is_volatile && !in_ram) {
+    throw std::runtime_error("Only memory regions in RAM can be volatile.");
+  }
+
+  for(auto const &mapped : regions) {
+    if(region.start < mapped.region.start + uint64_t{mapped.region.size_bytes}
+        && mapped.region.start < end) {
+      throw std::runtime_error("Memory regions overlap.");
+    }
+  }
+
+  auto const pages = (region.size_bytes + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE;
+  regions.push_back({region, std::vector<bool>(region.is_volatile ? pages : 0, false), {}});
+}
+
+void clear_memory_regions()
+{
+  regions.clear();
+}
+
+memory_region const *find_memory_region(uint32_t address)
+{
+  auto const mapped = find_region(address);
+
+  return mapped != nullptr ? &mapped->region : nullptr;
+}
+
+bool in_one_memory_region(uint32_t first, uint32_t last)
+{
+  for(auto const &mapped : regions) {
+    uint64_t const end = static_cast<uint64_t>(mapped.region.start) + mapped.region.size_bytes;
+    auto const overlaps = first < end && mapped.region.start <= last;
+    if(overlaps && (first < mapped.region.start || last >= end)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void track_loaded_memory()
+{
+  for(auto &mapped : regions) {
+    if(!mapped.region.is_volatile) {
+      continue;
+    }
+
+    uint64_t const end = static_cast<uint64_t>(mapped.region.start) + mapped.region.size_bytes;
+    for(uint64_t address = mapped.region.start; address < end; address += 4) {
+      if(RAM[(address & RAM_ADDRESS_MASK) >> 2] != 0) {
+        touch_page(mapped, static_cast<uint32_t>(address));
+      }
+    }
+  }
+}
+
+uint64_t power_off_memory()
+{
+  uint64_t poisoned = 0;
+
+  for(auto const &mapped : regions) {
+    uint64_t const end = static_cast<uint64_t>(mapped.region.start) + mapped.region.size_bytes;
+
+    for(auto const page : mapped.pages) {
+      uint64_t const begin = mapped.region.start + uint64_t{page} * MEMORY_PAGE_SIZE;
+      auto const page_end = std::min<uint64_t>(begin + MEMORY_PAGE_SIZE, end);
+      for(auto address = begin; address < page_end; address += 4) {
+        RAM[(address & RAM_ADDRESS_MASK) >> 2] = MEMORY_POISON;
+      }
+    }
+
+    poisoned += mapped.pages.size();
+  }
+
+  return poisoned;
+}
+
 uint32_t ram_load(uint32_t address, bool false_read)
 {
   auto data = RAM[(address & RAM_ADDRESS_MASK) >> 2];
@@ -43,17 +195,13 @@ void fetch_instruction(uint32_t address, uint16_t *value)
 
   if(address >= RAM_START) {
     if(address >= (RAM_START + RAM_SIZE_BYTES)) {
-      fprintf(
-          stderr, "Error: ILR Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, 0);
     }
 
     fromMem = ram_load(address, false);
   } else {
     if(address >= (FLASH_START + FLASH_SIZE_BYTES)) {
-      fprintf(
-          stderr, "Error: ILF Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, 0);
     }
 
     fromMem = FLASH_MEMORY[(address & FLASH_ADDRESS_MASK) >> 2];
@@ -68,35 +216,38 @@ void load(uint32_t address, uint32_t *value, uint32_t false_read)
   if(address >= RAM_START) {
     if(address >= (RAM_START + RAM_SIZE_BYTES)) {
       // Check for UART
-      if(address == 0xE0000000) {
+      if(address == UART_ADDRESS) {
         *value = 0;
         return;
       }
 
       // Check for SYSTICK
       if((address >> 4) == 0xE000E01) {
-        *value = ((uint32_t *)&SYSTICK)[(address >> 2) & 0x3];
-        if(address == 0xE000E010)
-          SYSTICK.control &= 0x00010000;
+        *value = systick_read(address);
+        return;
+      }
 
+      // Check for the system control block
+      if((address >> 8) == 0xE000ED) {
+        *value = system_control_read(address);
         return;
       }
 
-      fprintf(
-          stderr, "Error: DLR Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, insn);
     }
 
     *value = ram_load(address, false_read == 1);
   } else {
     if(address >= (FLASH_START + FLASH_SIZE_BYTES)) {
-      fprintf(
-          stderr, "Error: DLF Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, insn);
     }
 
     *value = FLASH_MEMORY[(address & FLASH_ADDRESS_MASK) >> 2];
   }
+
+  if(!regions.empty() && false_read == 0) {
+    account_load(address);
+  }
 }
 
 void store(uint32_t address, uint32_t value)
@@ -104,42 +255,37 @@ void store(uint32_t address, uint32_t value)
   if(address >= RAM_START) {
     if(address >= (RAM_START + RAM_SIZE_BYTES)) {
       // Check for UART
-      if(address == 0xE0000000) {
+      if(address == UART_ADDRESS) {
+        console_write(static_cast<char>(value & 0xFF));
         return;
       }
 
       // Check for SYSTICK
       if((address >> 4) == 0xE000E01 && address != 0xE000E01C) {
-        if(address == 0xE000E010) {
-          SYSTICK.control = (value & 0x1FFFD) | 0x4; // No external tick source, no interrupt
-
-          if(value & 0x2) {
-            fprintf(stderr, "Warning: SYSTICK interrupts not implemented, ignoring\n");
-          }
-        } else if(address == 0xE000E014) {
-          SYSTICK.reload = value & 0xFFFFFF;
-        } else if(address == 0xE000E018) {
-          // Reads clears current value
-          SYSTICK.value = 0;
-        }
+        systick_write(address, value);
+        return;
+      }
 
+      // Check for the system control block
+      if((address >> 8) == 0xE000ED) {
+        system_control_write(address, value);
         return;
       }
 
-      fprintf(
-          stderr, "Error: DSR Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, insn);
     }
 
     ram_store(address, value);
   } else {
     if(address >= (FLASH_START + FLASH_SIZE_BYTES)) {
-      fprintf(
-          stderr, "Error: DSF Memory access out of range: 0x%8.8X, pc=%x\n", address, cpu_get_pc());
-      terminate_simulation(1);
+      terminate_simulation(fault_type::memory_out_of_range, address, insn);
     }
 
     FLASH_MEMORY[(address & FLASH_ADDRESS_MASK) >> 2] = value;
   }
+
+  if(!regions.empty()) {
+    account_store(address);
+  }
 }
 }
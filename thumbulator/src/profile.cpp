@@ -0,0 +1,35 @@
+#include "thumbulator/profile.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace thumbulator {
+
+constexpr uint32_t execution_profile::ENTRIES;
+
+// calloc leaves untouched pages unmapped, unlike value-initializing a vector
+execution_profile::execution_profile()
+    : counters(static_cast<pc_counters *>(std::calloc(ENTRIES, sizeof(pc_counters))), &std::free)
+{
+  if(counters == nullptr) {
+    throw std::bad_alloc();
+  }
+}
+
+std::vector<std::pair<uint32_t, pc_counters>> execution_profile::hot_spots() const
+{
+  std::vector<std::pair<uint32_t, pc_counters>> result;
+  for(uint32_t index = 0; index < ENTRIES; ++index) {
+    if(counters[index].executions != 0) {
+      result.emplace_back(FLASH_START + (index << 1), counters[index]);
+    }
+  }
+
+  std::stable_sort(result.begin(), result.end(),
+      [](std::pair<uint32_t, pc_counters> const &a, std::pair<uint32_t, pc_counters> const &b) {
+        return a.second.cycles > b.second.cycles;
+      });
+
+  return result;
+}
+}
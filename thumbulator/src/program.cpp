@@ -0,0 +1,319 @@
+#include "thumbulator/program.hpp"
+
+#include "thumbulator/hle.hpp"
+#include "thumbulator/memory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace thumbulator {
+
+namespace {
+
+// the parts of the ELF format the loader needs, see the ARM ELF specification
+constexpr uint8_t ELF_MAGIC[4] = {0x7F, 'E', 'L', 'F'};
+constexpr uint8_t ELF_CLASS_32 = 1;
+constexpr uint8_t ELF_DATA_LITTLE_ENDIAN = 1;
+constexpr uint16_t ELF_MACHINE_ARM = 40;
+constexpr uint32_t ELF_SEGMENT_LOAD = 1;
+constexpr uint32_t ELF_SECTION_SYMBOLS = 2;
+constexpr uint8_t ELF_SYMBOL_OBJECT = 1;
+constexpr uint8_t ELF_SYMBOL_FUNCTION = 2;
+
+struct elf_header {
+  uint8_t ident[16];
+  uint16_t type;
+  uint16_t machine;
+  uint32_t version;
+  uint32_t entry;
+  uint32_t program_headers;
+  uint32_t section_headers;
+  uint32_t flags;
+  uint16_t header_size;
+  uint16_t program_header_size;
+  uint16_t program_header_count;
+  uint16_t section_header_size;
+  uint16_t section_header_count;
+  uint16_t section_names;
+};
+
+struct elf_program_header {
+  uint32_t type;
+  uint32_t offset;
+  uint32_t virtual_address;
+  uint32_t physical_address;
+  uint32_t file_size;
+  uint32_t memory_size;
+  uint32_t flags;
+  uint32_t align;
+};
+
+struct elf_section_header {
+  uint32_t name;
+  uint32_t type;
+  uint32_t flags;
+  uint32_t address;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t link;
+  uint32_t info;
+  uint32_t align;
+  uint32_t entry_size;
+};
+
+struct elf_symbol {
+  uint32_t name;
+  uint32_t value;
+  uint32_t size;
+  uint8_t info;
+  uint8_t other;
+  uint16_t section;
+};
+
+/**
+ * A read-only memory mapping of the application file.
+ */
+class mapped_program {
+public:
+  explicit mapped_program(std::string const &path_to_program)
+  {
+    auto const fd = open(path_to_program.c_str(), O_RDONLY);
+    if(fd < 0) {
+      throw std::runtime_error("Could not open binary file: " + path_to_program);
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0) {
+      close(fd);
+      throw std::runtime_error("Binary file is empty: " + path_to_program);
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    data = static_cast<uint8_t const *>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+
+    if(data == MAP_FAILED) {
+      throw std::runtime_error("Could not map binary file: " + path_to_program);
+    }
+  }
+
+  ~mapped_program()
+  {
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+
+  mapped_program(mapped_program const &) = delete;
+  mapped_program &operator=(mapped_program const &) = delete;
+
+  bool is_elf() const
+  {
+    return size >= sizeof(elf_header) && std::memcmp(data, ELF_MAGIC, sizeof(ELF_MAGIC)) == 0;
+  }
+
+  /**
+   * Get a structure from the file, checking that it is inside the file.
+   */
+  template <typename T>
+  T const &at(uint64_t offset) const
+  {
+    if(offset + sizeof(T) > size) {
+      throw std::runtime_error("ELF file is truncated.");
+    }
+
+    return *reinterpret_cast<T const *>(data + offset);
+  }
+
+  uint8_t const *data;
+  size_t size;
+};
+
+elf_header const &read_elf_header(mapped_program const &file)
+{
+  auto const &header = file.at<elf_header>(0);
+  if(header.ident[4] != ELF_CLASS_32 || header.ident[5] != ELF_DATA_LITTLE_ENDIAN
+      || header.machine != ELF_MACHINE_ARM) {
+    throw std::runtime_error("Only little-endian, 32-bit ARM ELF files are supported.");
+  }
+
+  return header;
+}
+
+/**
+ * Find where an address is in the simulator's memory.
+ *
+ * @return A pointer to the bytes at the address, or nullptr if the range is not in memory.
+ */
+uint8_t *host_address(uint32_t address, uint32_t size)
+{
+  auto const end = static_cast<uint64_t>(address) + size;
+
+  // flash starts at the lowest address, so only the end of the range needs checking
+  static_assert(FLASH_START == 0, "Flash must start at address zero.");
+  if(end <= FLASH_START + FLASH_SIZE_BYTES) {
+    return reinterpret_cast<uint8_t *>(FLASH_MEMORY) + (address - FLASH_START);
+  }
+
+  if(address >= RAM_START && end <= static_cast<uint64_t>(RAM_START) + RAM_SIZE_BYTES) {
+    return reinterpret_cast<uint8_t *>(RAM) + (address - RAM_START);
+  }
+
+  return nullptr;
+}
+
+void place_segment(mapped_program const &file, elf_program_header const &segment, uint32_t address)
+{
+  auto destination = host_address(address, segment.memory_size);
+  if(destination == nullptr) {
+    throw std::runtime_error("ELF segment is outside of the simulated memory.");
+  }
+
+  if(segment.file_size > segment.memory_size
+      || static_cast<uint64_t>(segment.offset) + segment.file_size > file.size) {
+    throw std::runtime_error("ELF file is truncated.");
+  }
+
+  // the rest of the segment, like .bss, is already zero
+  std::memcpy(destination, file.data + segment.offset, segment.file_size);
+}
+
+void load_elf(mapped_program const &file)
+{
+  auto const &header = read_elf_header(file);
+
+  for(uint32_t i = 0; i < header.program_header_count; ++i) {
+    auto const &segment = file.at<elf_program_header>(
+        header.program_headers + static_cast<uint64_t>(i) * header.program_header_size);
+    if(segment.type != ELF_SEGMENT_LOAD || segment.memory_size == 0) {
+      continue;
+    }
+
+    place_segment(file, segment, segment.virtual_address);
+
+    // keep the load image too, in case the application copies it anyway
+    if(segment.physical_address != segment.virtual_address && segment.file_size != 0) {
+      place_segment(file, segment, segment.physical_address);
+    }
+  }
+}
+
+symbol_table read_elf_symbols(mapped_program const &file)
+{
+  auto const &header = read_elf_header(file);
+
+  auto const section = [&](uint32_t index) -> elf_section_header const & {
+    return file.at<elf_section_header>(
+        header.section_headers + static_cast<uint64_t>(index) * header.section_header_size);
+  };
+
+  symbol_table table;
+  for(uint32_t i = 0; i < header.section_header_count; ++i) {
+    auto const &symbols = section(i);
+    if(symbols.type != ELF_SECTION_SYMBOLS || symbols.entry_size < sizeof(elf_symbol)) {
+      continue;
+    }
+
+    auto const &names = section(symbols.link);
+    if(static_cast<uint64_t>(names.offset) + names.size > file.size) {
+      throw std::runtime_error("ELF file is truncated.");
+    }
+
+    auto const name_data = reinterpret_cast<char const *>(file.data + names.offset);
+    for(uint32_t s = 0; s < symbols.size / symbols.entry_size; ++s) {
+      auto const &entry =
+          file.at<elf_symbol>(symbols.offset + static_cast<uint64_t>(s) * symbols.entry_size);
+
+      auto const type = entry.info & 0xF;
+      if((type != ELF_SYMBOL_FUNCTION && type != ELF_SYMBOL_OBJECT) || entry.name >= names.size) {
+        continue;
+      }
+
+      auto const name_length = strnlen(name_data + entry.name, names.size - entry.name);
+      symbol found{std::string(name_data + entry.name, name_length), entry.value, entry.size,
+          type == ELF_SYMBOL_FUNCTION};
+      if(found.is_function) {
+        // the lowest bit marks thumb code, not part of the address
+        found.address &= ~0x1u;
+      }
+
+      table.add(found);
+    }
+  }
+
+  return table;
+}
+}
+
+void symbol_table::add(symbol const &to_add)
+{
+  by_name[to_add.name] = symbols.size();
+  symbols.push_back(to_add);
+
+  if(to_add.is_function) {
+    auto const index = symbols.size() - 1;
+    auto const position = std::upper_bound(functions.begin(), functions.end(), index,
+        [this](size_t a, size_t b) { return symbols[a].address < symbols[b].address; });
+    functions.insert(position, index);
+  }
+}
+
+symbol const *symbol_table::find(std::string const &name) const
+{
+  auto const found = by_name.find(name);
+
+  return found == by_name.end() ? nullptr : &symbols[found->second];
+}
+
+symbol const *symbol_table::function_at(uint32_t address) const
+{
+  // the last function that starts at or before the address
+  auto const after = std::upper_bound(functions.begin(), functions.end(), address,
+      [this](uint32_t a, size_t index) { return a < symbols[index].address; });
+  if(after == functions.begin()) {
+    return nullptr;
+  }
+
+  auto const &function = symbols[*(after - 1)];
+  if(function.size != 0 && address >= function.address + function.size) {
+    return nullptr;
+  }
+
+  return &function;
+}
+
+symbol_table load_program(std::string const &path_to_program)
+{
+  mapped_program const file(path_to_program);
+
+  if(!file.is_elf()) {
+    if(file.size > FLASH_SIZE_BYTES) {
+      throw std::runtime_error("Binary file does not fit in flash memory.");
+    }
+
+    std::memcpy(FLASH_MEMORY, file.data, file.size);
+
+    return symbol_table();
+  }
+
+  load_elf(file);
+
+  auto symbols = read_elf_symbols(file);
+  if(INTERCEPT_RUNTIME_HELPERS) {
+    intercept_runtime_helpers(symbols);
+  }
+
+  return symbols;
+}
+
+symbol_table read_symbols(std::string const &path_to_program)
+{
+  mapped_program const file(path_to_program);
+
+  return file.is_elf() ? read_elf_symbols(file) : symbol_table();
+}
+}
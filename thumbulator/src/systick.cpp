@@ -0,0 +1,113 @@
+#include "thumbulator/cpu.hpp"
+
+#include "thumbulator/event.hpp"
+#include "thumbulator/exception.hpp"
+
+#include <algorithm>
+
+namespace thumbulator {
+
+namespace {
+
+constexpr uint32_t SYSTICK_CSR = 0xE000E010;
+constexpr uint32_t SYSTICK_RVR = 0xE000E014;
+constexpr uint32_t SYSTICK_CVR = 0xE000E018;
+
+constexpr uint32_t SYSTICK_ENABLE = 0x1;
+constexpr uint32_t SYSTICK_TICKINT = 0x2;
+constexpr uint32_t SYSTICK_COUNTFLAG = 0x00010000;
+
+// the cycle SYSTICK.value was current at
+uint64_t reference_cycle = 0;
+
+bool enabled()
+{
+  return (SYSTICK.control & SYSTICK_ENABLE) != 0;
+}
+}
+
+uint32_t systick_read(uint32_t address)
+{
+  if(address == SYSTICK_CVR) {
+    systick_update();
+  }
+
+  auto const value = (reinterpret_cast<uint32_t const *>(&SYSTICK))[(address >> 2) & 0x3];
+
+  // reading the control register clears COUNTFLAG
+  if(address == SYSTICK_CSR) {
+    SYSTICK.control &= ~SYSTICK_COUNTFLAG;
+  }
+
+  return value;
+}
+
+void systick_write(uint32_t address, uint32_t value)
+{
+  if(address == SYSTICK_CSR) {
+    auto const was_enabled = enabled();
+
+    systick_update();
+    // No external tick source, COUNTFLAG is read-only
+    SYSTICK.control =
+        (SYSTICK.control & SYSTICK_COUNTFLAG) | (value & (SYSTICK_ENABLE | SYSTICK_TICKINT)) | 0x4;
+
+    if(enabled() != was_enabled) {
+      systick_resume();
+    }
+  } else if(address == SYSTICK_RVR) {
+    SYSTICK.reload = value & 0xFFFFFF;
+
+    // a counter that stopped at zero for lack of a reload value starts again
+    systick_update();
+    if(SYSTICK.value == 0) {
+      systick_resume();
+    }
+  } else if(address == SYSTICK_CVR) {
+    // writes clear the current value
+    SYSTICK.value = 0;
+    systick_resume();
+  }
+}
+
+void systick_update()
+{
+  if(enabled()) {
+    auto const elapsed = std::min<uint64_t>(CYCLE_COUNT - reference_cycle, SYSTICK.value);
+    SYSTICK.value -= static_cast<uint32_t>(elapsed);
+  }
+
+  reference_cycle = CYCLE_COUNT;
+}
+
+void systick_resume()
+{
+  reference_cycle = CYCLE_COUNT;
+
+  if(enabled()) {
+    schedule_event(event_type::systick_wrap, CYCLE_COUNT + SYSTICK.value);
+  } else {
+    cancel_event(event_type::systick_wrap);
+  }
+}
+
+void systick_wrap(uint64_t cycle)
+{
+  // counting down to zero sets COUNTFLAG, reloading a cleared counter does not
+  if(SYSTICK.value > 0) {
+    SYSTICK.control |= SYSTICK_COUNTFLAG;
+
+    if((SYSTICK.control & SYSTICK_TICKINT) != 0) {
+      pend_exception(EXCEPTION_SYSTICK);
+    }
+  }
+
+  SYSTICK.value = SYSTICK.reload;
+  reference_cycle = cycle;
+
+  // without a reload value, the counter stays at zero
+  if(SYSTICK.reload > 0) {
+    schedule_event(event_type::systick_wrap, cycle + SYSTICK.reload);
+  }
+}
+}